@@ -0,0 +1,862 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Common.h"
+#include "FrameRateController.hpp"
+#include "GazeGenerator.hpp"
+#include "GazePredictor.hpp"
+#include "GazeRecording.hpp"
+#include "GazeReplay.hpp"
+#include "OneEuroFilter.hpp"
+#include "SoftKernels.hpp"
+#include "SoftRender.hpp"
+#include "SpscRing.hpp"
+#include "Telemetry.hpp"
+#include "ThreadPool.hpp"
+#include "TiledHeatField.hpp"
+
+
+namespace Benchmark
+{
+	// 至少跑满 minSeconds，返回每次调用的平均秒数
+	static double TimePerCall(const std::function<void()>& body, double minSeconds = 0.25)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		body();
+
+		uint64_t calls = 0;
+		auto     start = Clock::now();
+		auto     elapsed = 0.0;
+
+		do
+		{
+			body();
+			++calls;
+			elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+		}
+		while (elapsed < minSeconds);
+
+		return elapsed / static_cast<double>(calls);
+	}
+
+	static void PrintRow(std::ostream& out, const char* name, double megaPixelsPerSecond, double baseline)
+	{
+		out << "  " << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(1) << std::setw(10) << megaPixelsPerSecond << " MP/s" << std::setw(8) << std::setprecision(2) << megaPixelsPerSecond / baseline << "x" << std::endl;
+	}
+
+	static void PassKernel(std::ostream& out, const char* name, uint32_t width, uint32_t height, SplatRowKernel (*getKernel)(SimdLevel), SplatParams (*getParams)(const PSConstantData&))
+	{
+		std::vector<float> field(static_cast<size_t>(width) * height, 0.5f);
+
+		PSConstantData data = {};
+		data.GazePoint      = {0.5f, 0.5f};
+		data.AspectRatio    = static_cast<float>(width) / static_cast<float>(height);
+		data.SizeSquared    = 0.12f * 0.12f;
+		data.Trail          = 0.5f;
+		data.Decay          = 0.9975f;
+		data.GainScale      = 1.0f;
+
+		auto params = getParams(data);
+
+		out << name << " " << width << "x" << height << std::endl;
+
+		auto megaPixels = static_cast<double>(width) * height / 1e6;
+		auto baseline   = 0.0;
+
+		for (auto level : {SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2})
+		{
+			if (level > SoftKernels::ActiveSimdLevel())
+				break;
+
+			auto kernel  = getKernel(level);
+			auto seconds = TimePerCall([&] { SoftKernels::RunPass(field.data(), width, height, width, kernel, params); });
+			auto rate    = megaPixels / seconds;
+
+			if (level == SimdLevel::Scalar)
+				baseline = rate;
+
+			PrintRow(out, SoftKernels::SimdLevelName(level), rate, baseline);
+		}
+	}
+
+	static void PassKernels(std::ostream& out, uint32_t width, uint32_t height)
+	{
+		PassKernel(out, "Heatmap pass", width, height, SoftKernels::HeatmapRowKernel, SoftKernels::HeatmapParams);
+		PassKernel(out, "Bubble pass", width, height, SoftKernels::BubbleRowKernel, SoftKernels::BubbleParams);
+		PassKernel(out, "Solid pass", width, height, SoftKernels::SolidRowKernel, SoftKernels::SolidParams);
+		PassKernel(out, "Heatmap capsule pass", width, height, SoftKernels::HeatmapCapsuleRowKernel, [](const PSConstantData& data) { return SoftKernels::CapsuleParams(SoftKernels::HeatmapParams(data), {0.25f, 0.25f}); });
+		PassKernel(out, "Bubble capsule pass", width, height, SoftKernels::BubbleCapsuleRowKernel, [](const PSConstantData& data) { return SoftKernels::CapsuleParams(SoftKernels::BubbleParams(data), {0.25f, 0.25f}); });
+	}
+
+	// 整帧 PushGazePoint + Render 的耗时，注视点在屏幕上来回移动
+	static void HeatmapFrame(std::ostream& out, const char* name, uint32_t width, uint32_t height, void (*configure)(SoftRender&))
+	{
+		SoftRender render(width, height);
+
+		TobiiRenderSettings settings = {};
+		settings.ShapeType           = Heatmap;
+		render.UpdateSettings(settings);
+		configure(render);
+
+		uint32_t frame = 0;
+
+		auto seconds = TimePerCall([&]
+		{
+			auto t = static_cast<float>(frame++ % 512) / 512.0f;
+			render.PushGazePoint(true, {t * width, (0.25f + t * 0.5f) * height});
+			render.Render();
+		});
+
+		out << "  " << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1) << std::setw(10) << seconds * 1e6 << " us/frame" << std::endl;
+	}
+
+	static void HeatmapFrames(std::ostream& out, uint32_t width, uint32_t height)
+	{
+		out << "Heatmap frame " << width << "x" << height << std::endl;
+
+		HeatmapFrame(out, "full-screen decay", width, height, [](SoftRender&) {});
+		HeatmapFrame(out, "lazy decay", width, height, [](SoftRender& render) { render.SetLazyDecay(true); });
+	}
+
+	// 一帧 samplesPerFrame 个采样: 逐个走整场 Pass 与 RenderSamples 批量处理对比
+	static void HeatmapBatch(std::ostream& out, uint32_t width, uint32_t height, uint32_t samplesPerFrame)
+	{
+		out << "Heatmap " << samplesPerFrame << " samples/frame " << width << "x" << height << std::endl;
+
+		TobiiRenderSettings settings = {};
+		settings.ShapeType           = Heatmap;
+
+		SoftRender perSample(width, height);
+		perSample.UpdateSettings(settings);
+
+		uint32_t frame = 0;
+
+		auto perSampleSeconds = TimePerCall([&]
+		{
+			for (uint32_t i = 0; i < samplesPerFrame; ++i)
+			{
+				auto t = static_cast<float>((frame * samplesPerFrame + i) % 4096) / 4096.0f;
+				perSample.PushGazePoint(true, {t * width, 0.5f * height});
+				perSample.Render();
+			}
+			++frame;
+		});
+
+		std::vector<GazeSample> samples(samplesPerFrame);
+
+		for (auto lazy : {false, true})
+		{
+			SoftRender batched(width, height);
+			batched.UpdateSettings(settings);
+			batched.SetLazyDecay(lazy);
+
+			int64_t timestamp = 1;
+			frame             = 0;
+
+			auto seconds = TimePerCall([&]
+			{
+				for (uint32_t i = 0; i < samplesPerFrame; ++i)
+				{
+					auto t     = static_cast<float>((frame * samplesPerFrame + i) % 4096) / 4096.0f;
+					samples[i] = {timestamp += 8333 / samplesPerFrame, {t * width, 0.5f * height}, true};
+				}
+				batched.RenderSamples(samples.data(), samples.size(), timestamp, 1.0 / 120.0);
+				++frame;
+			});
+
+			out << "  " << std::left << std::setw(24) << (lazy ? "batched, lazy decay" : "batched") << std::right << std::fixed << std::setprecision(1) << std::setw(10) << seconds * 1e6 << " us/frame" << std::setw(8) << std::setprecision(2) << perSampleSeconds / seconds << "x" << std::endl;
+		}
+
+		out << "  " << std::left << std::setw(24) << "one pass per sample" << std::right << std::fixed << std::setprecision(1) << std::setw(10) << perSampleSeconds * 1e6 << " us/frame" << std::endl;
+	}
+
+	// viewerCount 个人同屏: 每人一个 SoftRender（各自整场衰减一遍）与一个 SoftRender 带 viewerCount 个观看者对比
+	// 只计场的更新，合成的开销取决于变化的面积，两种做法相同
+	static void MultiViewer(std::ostream& out, uint32_t width, uint32_t height, uint32_t viewerCount)
+	{
+		out << "Heatmap " << viewerCount << " viewers " << width << "x" << height << std::endl;
+
+		TobiiRenderSettings settings = {};
+		settings.ShapeType           = Heatmap;
+
+		auto gazeAt = [&](uint32_t viewer, uint32_t frame) -> Point
+		{
+			auto t = static_cast<float>((frame + viewer * 97) % 512) / 512.0f;
+			return {t * width, (static_cast<float>(viewer) + 0.5f) / static_cast<float>(viewerCount) * height};
+		};
+
+		std::vector<std::unique_ptr<SoftRender>> separate;
+
+		for (uint32_t viewer = 0; viewer < viewerCount; ++viewer)
+		{
+			separate.push_back(std::make_unique<SoftRender>(width, height));
+			separate.back()->UpdateSettings(settings);
+		}
+
+		uint32_t frame = 0;
+
+		auto separateSeconds = TimePerCall([&]
+		{
+			for (uint32_t viewer = 0; viewer < viewerCount; ++viewer)
+			{
+				separate[viewer]->PushGazePoint(true, gazeAt(viewer, frame));
+				separate[viewer]->Render();
+			}
+			++frame;
+		});
+
+		SoftRender shared(width, height);
+		shared.UpdateSettings(settings);
+		shared.SetViewerCount(viewerCount);
+
+		frame = 0;
+
+		auto sharedSeconds = TimePerCall([&]
+		{
+			for (uint32_t viewer = 0; viewer < viewerCount; ++viewer)
+				shared.PushGazePoint(viewer, true, gazeAt(viewer, frame));
+
+			shared.Render();
+			++frame;
+		});
+
+		out << "  " << std::left << std::setw(24) << "one field, all viewers" << std::right << std::fixed << std::setprecision(1) << std::setw(10) << sharedSeconds * 1e6 << " us/frame" << std::setw(8) << std::setprecision(2) << separateSeconds / sharedSeconds << "x" << std::endl;
+		out << "  " << std::left << std::setw(24) << "one renderer per viewer" << std::right << std::fixed << std::setprecision(1) << std::setw(10) << separateSeconds * 1e6 << " us/frame" << std::endl;
+	}
+
+	// 分块场一帧（活块衰减 + 逐活块读取，代替合成）的耗时随占用率的变化，与稠密场整场处理对比
+	static void TiledOccupancy(std::ostream& out, uint32_t width, uint32_t height)
+	{
+		out << "Tiled field " << width << "x" << height << " (decay + read per frame)" << std::endl;
+
+		std::vector<float> dense(static_cast<size_t>(width) * height, 1.0f);
+		auto               denseSum = 0.0f;
+
+		auto denseSeconds = TimePerCall([&]
+		{
+			SplatParams params = {};
+			params.Decay       = 1.0f;
+			SoftKernels::RunPass(dense.data(), width, height, width, SoftKernels::SolidRowKernel(SoftKernels::ActiveSimdLevel()), params);
+
+			for (auto value : dense)
+				denseSum += value;
+		});
+
+		out << "  " << std::left << std::setw(12) << "dense" << std::right << std::fixed << std::setprecision(1) << std::setw(10) << denseSeconds * 1e6 << " us/frame" << std::endl;
+
+		for (auto fraction : {0.01, 0.05, 0.1, 0.25, 0.5, 1.0})
+		{
+			TiledHeatField field(width, height);
+
+			auto tileCount = field.GetTileCount();
+			auto liveCount = std::max(1u, static_cast<uint32_t>(fraction * tileCount + 0.5));
+
+			// 活块均匀散布在整张场上
+			for (uint32_t i = 0; i < liveCount; ++i)
+			{
+				auto tileIndex = static_cast<uint32_t>(static_cast<uint64_t>(i) * tileCount / liveCount);
+				auto pTile     = field.AcquireTile(tileIndex % field.GetTilesX(), tileIndex / field.GetTilesX());
+				std::fill(pTile, pTile + TiledHeatField::TileArea, 1.0f);
+			}
+
+			auto tiledSum = 0.0f;
+			auto seconds  = TimePerCall([&]
+			{
+				field.Decay(1.0f);
+				field.ForEachLiveTile([&](uint32_t, uint32_t, const float* pTile)
+				{
+					for (uint32_t i = 0; i < TiledHeatField::TileArea; ++i)
+						tiledSum += pTile[i];
+				});
+			});
+
+			out << "  " << std::setw(4) << std::setprecision(0) << fraction * 100.0 << "% live" << std::setprecision(1) << std::setw(12) << seconds * 1e6 << " us/frame" << std::setw(8) << std::setprecision(2) << denseSeconds / seconds << "x" << std::endl;
+		}
+	}
+
+	// 只测合成: 四分之一分辨率场双线性上采样 + 查表，输出整帧 R8G8B8A8
+	static void CompositeFrame(std::ostream& out, uint32_t width, uint32_t height, ShapeTypes shapeType)
+	{
+		out << "Composite " << (shapeType == Heatmap ? "heatmap " : "bubble ") << width << "x" << height << std::endl;
+
+		SoftRender render(width, height);
+
+		TobiiRenderSettings settings = {};
+		settings.ShapeType           = shapeType;
+		render.UpdateSettings(settings);
+
+		// 先铺一段轨迹，让场里有一部分像素高于阈值
+		for (uint32_t frame = 0; frame < 240; ++frame)
+		{
+			auto t = static_cast<float>(frame) / 240.0f;
+			render.PushGazePoint(true, {t * width, (0.25f + t * 0.5f) * height});
+			render.Render();
+		}
+
+		std::vector<uint32_t> image(static_cast<size_t>(width) * height);
+
+		render.Invalidate();
+
+		auto megaPixels = static_cast<double>(width) * height / 1e6;
+		auto seconds    = TimePerCall([&] { render.Composite(image.data(), width); });
+
+		out << "  " << std::fixed << std::setprecision(1) << megaPixels / seconds << " MP/s, " << std::setprecision(0) << 1.0 / seconds << " frames/s" << std::endl;
+	}
+
+	// 全分辨率场上一帧累积 + 合成在 1..N 个线程下的耗时，效率 = 加速比 / 线程数
+	static void ThreadScaling(std::ostream& out, uint32_t width, uint32_t height, uint32_t downsampleFactor)
+	{
+		out << "Threaded accumulate + composite " << width << "x" << height << ", field 1/" << downsampleFactor << std::endl;
+
+		std::vector<uint32_t> image(static_cast<size_t>(width) * height);
+
+		// 1, 2, 4, ... 以及全部核心
+		std::vector<uint32_t> threadCounts;
+		auto                  maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+		for (uint32_t threads = 1; threads < maxThreads; threads *= 2)
+			threadCounts.push_back(threads);
+		threadCounts.push_back(maxThreads);
+
+		auto baseline = 0.0;
+
+		for (auto threads : threadCounts)
+		{
+			ThreadPool pool(threads);
+			SoftRender render(width, height);
+
+			TobiiRenderSettings settings = {};
+			settings.ShapeType           = Heatmap;
+			render.UpdateSettings(settings);
+			render.SetDownsampleFactor(downsampleFactor);
+			render.SetThreadPool(&pool);
+
+			uint32_t frame = 0;
+
+			auto seconds = TimePerCall([&]
+			{
+				auto t = static_cast<float>(frame++ % 512) / 512.0f;
+				render.PushGazePoint(true, {t * width, 0.5f * height});
+				render.Render();
+				render.Composite(image.data(), width);
+			});
+
+			if (threads == 1)
+				baseline = seconds;
+
+			auto speedup = baseline / seconds;
+
+			out << "  " << std::setw(3) << threads << " threads" << std::fixed << std::setprecision(1) << std::setw(12) << seconds * 1e3 << " ms/frame" << std::setw(8) << std::setprecision(2) << speedup << "x" << std::setw(8) << std::setprecision(0) << speedup / threads * 100.0 << "% efficiency" << std::endl;
+		}
+	}
+
+	// 一个生产者线程不停写入、一个消费者线程不停批量取走，跑 seconds 秒，tryPush / popAll 返回成功写入 / 取走的个数
+	template <typename TryPush, typename PopAll>
+	static void ProducerConsumer(std::ostream& out, const char* name, double seconds, TryPush&& tryPush, PopAll&& popAll)
+	{
+		std::atomic<bool> isRunning{true};
+		uint64_t          pushed   = 0;
+		uint64_t          rejected = 0;
+		uint64_t          popped   = 0;
+
+		auto start = std::chrono::steady_clock::now();
+
+		std::thread producer([&]
+		{
+			GazeSample sample = {0, {0.0f, 0.0f}, true};
+
+			while (isRunning.load(std::memory_order_relaxed))
+			{
+				++sample.Timestamp;
+
+				if (tryPush(sample))
+				{
+					++pushed;
+					continue;
+				}
+
+				// 满了或空了就让出时间片，核心数少时对方才有机会运行
+				++rejected;
+				std::this_thread::yield();
+			}
+		});
+
+		std::thread consumer([&]
+		{
+			while (isRunning.load(std::memory_order_relaxed))
+			{
+				auto count = popAll();
+				popped += count;
+
+				if (count == 0)
+					std::this_thread::yield();
+			}
+		});
+
+		std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+		isRunning = false;
+
+		producer.join();
+		consumer.join();
+
+		auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		out << "  " << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(10) << pushed / elapsed / 1e6 << " M push/s"
+			<< std::setw(10) << popped / elapsed / 1e6 << " M pop/s"
+			<< std::setw(10) << rejected / elapsed / 1e6 << " M full/s" << std::endl;
+	}
+
+	// 无锁环形缓冲与 std::mutex + std::deque 在一写一读同时满负荷时的吞吐
+	static void GazeRingContention(std::ostream& out, double seconds)
+	{
+		out << "Gaze ring contention, 1 producer + 1 consumer" << std::endl;
+
+		auto pRing = std::make_unique<GazeRing>();
+
+		// 消费者读一遍每个采样，与渲染线程的用法一致
+		int64_t lastTimestamp = 0;
+
+		ProducerConsumer(out, "SpscRing", seconds, [&](const GazeSample& sample) { return pRing->TryPush(sample); }, [&]
+		{
+			return pRing->PopAll([&](const GazeSample& sample) { lastTimestamp = std::max(lastTimestamp, sample.Timestamp); });
+		});
+
+		std::mutex             mutex;
+		std::deque<GazeSample> queue;
+		std::deque<GazeSample> drained;
+
+		ProducerConsumer(out, "mutex+deque", seconds, [&](const GazeSample& sample)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (queue.size() >= GazeRing::GetCapacity())
+				return false;
+
+			queue.push_back(sample);
+			return true;
+		}, [&]
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				drained.swap(queue);
+			}
+
+			auto count = static_cast<uint32_t>(drained.size());
+			drained.clear();
+			return count;
+		});
+	}
+
+	// 注视、扫视与平滑追随各占一部分的合成轨迹，Seed 固定，每次运行都相同
+	static std::vector<GazeSample> SyntheticGazeTrace(uint32_t sampleRate, float noise, double seconds)
+	{
+		GazeGeneratorParams params = {};
+		params.SampleRate          = sampleRate;
+		params.NoiseSigma          = noise;
+		params.PursuitProbability  = 0.5f;
+
+		return GazeGenerator::Generate(params, seconds);
+	}
+
+	// 生成速度，以及轨迹的 FNV-1a 散列: 同一个 Seed 在不同构建下散列应当相同
+	static void GazeGeneratorTrace(std::ostream& out, uint32_t sampleRate, double seconds)
+	{
+		GazeGeneratorParams params = {};
+		params.SampleRate          = sampleRate;
+
+		std::vector<GazeSample> samples;
+
+		auto elapsed = TimePerCall([&]
+		{
+			samples.clear();
+
+			GazeGenerator generator(params);
+			generator.Generate(samples, seconds);
+		});
+
+		uint64_t hash = 14695981039346656037ull;
+
+		auto mix = [&](const void* pData, size_t size)
+		{
+			for (size_t i = 0; i < size; ++i)
+				hash = (hash ^ static_cast<const uint8_t*>(pData)[i]) * 1099511628211ull;
+		};
+
+		for (const auto& sample : samples)
+		{
+			uint8_t isValid = sample.IsValid;
+
+			mix(&sample.Timestamp, sizeof(sample.Timestamp));
+			mix(&sample.Position, sizeof(sample.Position));
+			mix(&isValid, sizeof(isValid));
+		}
+
+		out << "Gaze generator " << sampleRate << " Hz, " << seconds << " s" << std::endl;
+		out << "  " << std::fixed << std::setprecision(1) << samples.size() / elapsed / 1e6 << " M samples/s, trace hash " << std::hex << std::setw(16) << std::setfill('0') << hash << std::dec << std::setfill(' ') << std::endl;
+	}
+
+	static void PredictionAccuracy(std::ostream& out, uint32_t sampleRate, float noise)
+	{
+		out << "Gaze prediction error, " << sampleRate << " Hz, noise " << std::defaultfloat << noise << " px" << std::endl;
+
+		auto samples = SyntheticGazeTrace(sampleRate, noise, 60.0);
+
+
+		for (int64_t horizon : {8000, 16000, 33000})
+		{
+			for (auto mode : {PredictionModes::None, PredictionModes::Kalman})
+			{
+				auto error = GazePredictor::Evaluate(samples.data(), samples.size(), mode, horizon);
+
+				out << "  " << std::setw(3) << horizon / 1000 << " ms " << std::left << std::setw(7) << (mode == PredictionModes::Kalman ? "kalman" : "none") << std::right << std::fixed << std::setprecision(1)
+					<< " mean" << std::setw(7) << error.Mean << " rms" << std::setw(7) << error.Rms << " p95" << std::setw(7) << error.P95 << " max" << std::setw(7) << error.Max << " px" << std::endl;
+			}
+		}
+	}
+
+	// 离线批量滤波: streamCount 条 120 Hz、stepCount 个采样的记录，逐条用 OneEuroFilter 与按 SoA 一起推进的吞吐
+	static void OneEuroThroughput(std::ostream& out, uint32_t streamCount, uint32_t stepCount)
+	{
+		out << "One-Euro filter " << streamCount << " streams x " << stepCount << " samples" << std::endl;
+
+		std::vector<float> dt(streamCount, 1.0f / 120.0f);
+		std::vector<float> x(static_cast<size_t>(streamCount) * stepCount);
+		std::vector<float> y(x.size());
+
+		for (size_t i = 0; i < x.size(); ++i)
+		{
+			x[i] = static_cast<float>(i * 7 % 1920);
+			y[i] = static_cast<float>(i * 13 % 1080);
+		}
+
+		auto samples = static_cast<double>(x.size());
+
+		auto print = [&](const char* name, double seconds, double baseline)
+		{
+			out << "  " << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(1) << std::setw(10) << samples / seconds / 1e6 << " M samples/s"
+				<< std::setw(12) << std::setprecision(0) << streamCount / seconds << " streams/s" << std::setw(8) << std::setprecision(2) << baseline / seconds << "x" << std::endl;
+		};
+
+		// 逐条: 每条流的采样连续存放
+		auto sink = 0.0f;
+
+		auto streamSeconds = TimePerCall([&]
+		{
+			for (uint32_t stream = 0; stream < streamCount; ++stream)
+			{
+				OneEuroFilter filter;
+
+				for (uint32_t step = 0; step < stepCount; ++step)
+				{
+					auto index = static_cast<size_t>(stream) * stepCount + step;
+					sink += filter.Filter({static_cast<int64_t>(step) * 8333, {x[index], y[index]}, true}).X;
+				}
+			}
+		});
+
+		print("stream", streamSeconds, streamSeconds);
+
+		// 按步: 同一步所有流的采样连续存放
+		for (auto level : {SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2})
+		{
+			if (level > SoftKernels::ActiveSimdLevel())
+				continue;
+
+			OneEuroBatch batch(level);
+
+			auto seconds = TimePerCall([&]
+			{
+				batch.Start(streamCount, x.data(), y.data());
+
+				for (uint32_t step = 1; step < stepCount; ++step)
+					batch.Step(dt.data(), x.data() + static_cast<size_t>(step) * streamCount, y.data() + static_cast<size_t>(step) * streamCount);
+
+				sink += batch.GetValueX()[0];
+			});
+
+			print(SoftKernels::SimdLevelName(level), seconds, streamSeconds);
+		}
+
+		if (sink == 1.0f)
+			out << std::endl;
+	}
+
+	// 记录格式的编码、解码吞吐和压缩率，与直接写 GazeSample 结构体相比
+	static void GazeRecordingCodec(std::ostream& out, uint32_t sampleRate, double seconds)
+	{
+		auto samples = SyntheticGazeTrace(sampleRate, 5.0f, seconds);
+
+		out << "Gaze recording " << samples.size() << " samples at " << sampleRate << " Hz" << std::endl;
+
+		std::vector<uint8_t> encoded;
+		encoded.reserve(samples.size() * 8);
+
+		auto encodeSeconds = TimePerCall([&]
+		{
+			encoded.clear();
+
+			GazeRecording::BlockEncoder encoder;
+
+			for (const auto& sample : samples)
+			{
+				encoder.AddSample(sample);
+
+				if (encoder.IsFull())
+					encoder.FinishBlock(encoded);
+			}
+
+			encoder.FinishBlock(encoded);
+		});
+
+		size_t  decodedCount = 0;
+		int64_t lastTimestamp = 0;
+
+		auto decodeSeconds = TimePerCall([&]
+		{
+			decodedCount = 0;
+
+			GazeRecording::DecodeBlocks(encoded.data(), encoded.size(), [&](const GazeSample& sample)
+			{
+				lastTimestamp = sample.Timestamp;
+				++decodedCount;
+			}, [](int64_t, const TobiiRenderSettings&) {});
+		});
+
+		auto bytesPerSample = static_cast<double>(encoded.size()) / samples.size();
+		auto eightHours     = bytesPerSample * sampleRate * 8 * 3600;
+
+		out << "  " << std::left << std::setw(10) << "encode" << std::right << std::fixed << std::setprecision(1) << std::setw(10) << samples.size() / encodeSeconds / 1e6 << " M samples/s" << std::endl;
+		out << "  " << std::left << std::setw(10) << "decode" << std::right << std::fixed << std::setprecision(1) << std::setw(10) << decodedCount / decodeSeconds / 1e6 << " M samples/s" << std::endl;
+		out << "  " << std::left << std::setw(10) << "size" << std::right << std::fixed << std::setprecision(2) << std::setw(10) << bytesPerSample << " bytes/sample, " << sizeof(GazeSample) << " raw, "
+			<< std::setprecision(0) << eightHours / 1e6 << " MB per 8 h" << std::endl;
+	}
+
+	// 按记录离线回放比较固定 120 帧与三种节能策略: 渲染的帧数、停止渲染的时间，以及相邻两帧注视点移动距离的 p99（越小越连贯）
+	// 合成轨迹每 10 秒中有 4 秒没有采样，相当于用户离开或鼠标不动；固定 120 帧在整段时间里每拍都渲染
+	static void AdaptiveFrameRate(std::ostream& out, uint32_t width, uint32_t height, double seconds)
+	{
+		GazeGeneratorParams params = {};
+		params.SampleRate          = 1200;
+		params.Width               = static_cast<float>(width);
+		params.Height              = static_cast<float>(height);
+		params.PursuitProbability  = 0.5f;
+
+		auto samples = GazeGenerator::Generate(params, seconds);
+
+		samples.erase(std::remove_if(samples.begin(), samples.end(), [&](const GazeSample& sample)
+		{
+			return (sample.Timestamp - params.StartTimestamp) % 10000000 >= 6000000;
+		}), samples.end());
+
+		out << "Adaptive frame rate " << width << "x" << height << ", " << seconds << " s trace" << std::endl;
+
+		auto run = [&](const char* name, FrameRateController* pController)
+		{
+			SoftRender render(width, height);
+
+			TobiiRenderSettings settings = {};
+			settings.TimeBasedDecay      = true;
+			render.UpdateSettings(settings);
+
+			std::vector<float> steps;
+			Point              lastGaze = {};
+			auto               hasLast  = false;
+
+			ReplayOptions options  = {};
+			options.FrameInterval  = 1;
+			options.RateController = pController;
+
+			GazeReplay replay(render, options, [&](SoftRender& renderer, int64_t)
+			{
+				const auto& data = renderer.GetRenderData();
+
+				if (data.HasGaze() && hasLast)
+					steps.push_back(std::hypot(data.CurrentGaze().X - lastGaze.X, data.CurrentGaze().Y - lastGaze.Y));
+
+				hasLast = data.HasGaze();
+				if (hasLast)
+					lastGaze = data.CurrentGaze();
+			});
+
+			auto start = std::chrono::steady_clock::now();
+
+			for (const auto& sample : samples)
+				replay.AddSample(sample);
+
+			// 最后 4 秒没有采样，也要按节拍推进到整段结束
+			replay.AdvanceTime(params.StartTimestamp + static_cast<int64_t>(seconds * 1e6));
+
+			auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			auto p99 = 0.0f;
+			if (!steps.empty())
+			{
+				auto index = steps.begin() + static_cast<ptrdiff_t>(steps.size() * 99 / 100);
+				std::nth_element(steps.begin(), index, steps.end());
+				p99 = *index;
+			}
+
+			auto stats   = replay.GetStats();
+			auto stopped = pController != nullptr ? pController->GetStats().StoppedSeconds / seconds * 100.0 : 0.0;
+
+			// 固定帧率的循环不管画面有没有变化每拍都渲染，自适应只算控制器放行并且真正渲染了的帧
+			auto frames = pController != nullptr ? stats.RenderedFrameCount : stats.FrameCount;
+
+			out << "  " << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1) << std::setw(8) << frames << " frames" << std::setw(8)
+				<< frames / seconds << " Hz mean" << std::setw(7) << stopped << "% stopped, step p99" << std::setw(6) << p99 << " px" << std::setw(8) << elapsed * 1e3 << " ms" << std::endl;
+		};
+
+		run("fixed 120 Hz", nullptr);
+
+		static const struct
+		{
+			const char*   Name;
+			PowerPolicies Policy;
+		} policies[] = {{"performance", PowerPolicies::Performance}, {"balanced", PowerPolicies::Balanced}, {"power saver", PowerPolicies::PowerSaver}};
+
+		for (const auto& policy : policies)
+		{
+			FrameRateController controller(FrameRateParams::FromPolicy(policy.Policy));
+			run(policy.Name, &controller);
+		}
+	}
+
+	// 每个阶段计时的开销（两次读时钟 + 记录），按 1 kHz 采样折算成占用的时间比例
+	// 以及直方图分位与精确排序结果的最大相对误差、采样线程一直在写时取一次快照的耗时
+	static void TelemetryOverhead(std::ostream& out)
+	{
+		out << "Telemetry" << std::endl;
+
+		Telemetry::SetEnabled(true);
+
+		auto enabled = TimePerCall([]
+		{
+			StageTimer timer(TelemetryStages::GazePush);
+		});
+
+		Telemetry::SetEnabled(false);
+
+		auto disabled = TimePerCall([]
+		{
+			StageTimer timer(TelemetryStages::GazePush);
+		});
+
+		Telemetry::SetEnabled(true);
+
+		// 关闭时只剩一次 relaxed 读，TimePerCall 每次调用自己还要读一次时钟，两者相减就是计时本身的开销
+		auto cost = std::max(enabled - disabled, 0.0);
+
+		out << "  " << std::left << std::setw(24) << "stage timer" << std::right << std::fixed << std::setprecision(1) << std::setw(10) << cost * 1e9 << " ns per stage, " << std::setprecision(4)
+			<< cost * 1000.0 * 100.0 << "% at 1 kHz" << std::endl;
+
+		// 0.5 us ~ 50 ms 的对数均匀分布，覆盖各阶段可能的耗时
+		std::vector<uint64_t> values(1000000);
+		uint64_t              state = 1;
+
+		for (auto& value : values)
+		{
+			state = state * 6364136223846793005ull + 1442695040888963407ull;
+			value = static_cast<uint64_t>(500.0 * std::pow(1e5, static_cast<double>(state >> 11) / 9007199254740992.0));
+		}
+
+		auto pHistogram = std::make_unique<HdrHistogram>();
+		for (auto value : values)
+			pHistogram->Record(value);
+
+		std::vector<uint64_t> counts(HdrHistogram::BucketCount);
+		uint64_t              totalCount = 0, sum = 0, max = 0;
+		pHistogram->AddTo(counts, totalCount, sum, max);
+
+		std::sort(values.begin(), values.end());
+
+		auto maxError = 0.0;
+
+		for (auto quantile : {0.5, 0.9, 0.99, 0.999, 0.9999})
+		{
+			auto exact    = static_cast<double>(values[static_cast<size_t>(std::ceil(quantile * values.size())) - 1]);
+			auto reported = static_cast<double>(HdrHistogram::ValueAtQuantile(counts, totalCount, quantile));
+
+			maxError = std::max(maxError, std::fabs(reported - exact) / exact);
+		}
+
+		out << "  " << std::left << std::setw(24) << "quantile error" << std::right << std::setprecision(2) << std::setw(10) << maxError * 100.0 << " % max, "
+			<< sizeof(HdrHistogram) / 1024 << " KB per histogram" << std::endl;
+
+		// 采样线程按 1 kHz 的节奏连续写，渲染线程取快照
+		std::atomic<bool> isRunning{true};
+
+		std::thread writer([&]
+		{
+			while (isRunning.load(std::memory_order_relaxed))
+			{
+				StageTimer timer(TelemetryStages::GazePush);
+				std::this_thread::sleep_for(std::chrono::microseconds(1000));
+			}
+		});
+
+		TelemetrySnapshot snapshot = {};
+
+		auto snapshotSeconds = TimePerCall([&]
+		{
+			snapshot = Telemetry::Snapshot();
+		});
+
+		isRunning = false;
+		writer.join();
+
+		out << "  " << std::left << std::setw(24) << "snapshot" << std::right << std::setprecision(1) << std::setw(10) << snapshotSeconds * 1e6 << " us, " << snapshot.ThreadCount << " threads" << std::endl;
+
+		Telemetry::Reset();
+	}
+
+	static void RunAll(std::ostream& out)
+	{
+		// 1080p 与 4K 的四分之一分辨率场，以及 8K 全分辨率场
+		PassKernels(out, 1920 / 4, 1080 / 4);
+		PassKernels(out, 3840 / 4, 2160 / 4);
+		PassKernels(out, 7680, 4320);
+
+		HeatmapFrames(out, 3840, 2160);
+		HeatmapFrames(out, 3 * 2560, 1440);
+
+		HeatmapBatch(out, 3840, 2160, 10);
+
+		MultiViewer(out, 1920, 1080, 8);
+
+		TiledOccupancy(out, 3840 / 4, 2160 / 4);
+
+		CompositeFrame(out, 3840, 2160, Heatmap);
+		CompositeFrame(out, 3840, 2160, Bubble);
+
+		ThreadScaling(out, 7680, 4320, 1);
+
+		GazeRingContention(out, 1.0);
+
+		PredictionAccuracy(out, 120, 5.0f);
+		PredictionAccuracy(out, 1000, 5.0f);
+
+		OneEuroThroughput(out, 4096, 1200);
+
+		GazeRecordingCodec(out, 1200, 600.0);
+
+		GazeGeneratorTrace(out, 2000, 600.0);
+
+		AdaptiveFrameRate(out, 1920, 1080, 60.0);
+
+		TelemetryOverhead(out);
+	}
+}
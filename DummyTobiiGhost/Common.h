@@ -1,4 +1,5 @@
 ﻿#pragma once
+#include <cstdint>
 
 
 enum ShapeTypes
@@ -39,7 +40,16 @@ struct Point
 	float Y;
 };
 
+// 一次眼动仪采样，Timestamp 单位为微秒，Position 为窗口像素坐标
+struct GazeSample
+{
+	int64_t Timestamp;
+	Point   Position;
+	bool    IsValid;
+};
+
 
+#ifdef _WIN32
 struct ShapeResource
 {
 	ID3D11Texture2D*          pTexture;
@@ -65,6 +75,7 @@ struct RenderTargetResource
 		Utils::SafeRelease(pSrv);
 	}
 };
+#endif
 
 struct PSConstantData
 {
@@ -75,7 +86,8 @@ struct PSConstantData
 	float        SizeSquared;
 	float        Trail;
 	float        Decay;
-	float        Padding[2];
+	float        GainScale; // splat 热量相对参考帧率下一帧的倍数，TimeBasedDecay 时随 dt 变化；只有 SoftKernels 读取，Shader 里仍是填充
+	float        Padding;
 };
 
 struct Vertex
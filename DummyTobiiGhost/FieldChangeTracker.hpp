@@ -0,0 +1,256 @@
+﻿#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "SoftKernels.hpp"
+
+
+// 按块记录场的变化，不读回场，只根据每个 Pass 的参数推算上界，GPU 和 CPU 渲染器共用
+// 每块两个上界: 块内最大值 Peak，以及上次合成以来块内任一像素的累计变化量 Change
+// Change 可能让合成结果变化超过一个 8 位量化级的块才算脏，需要重新合成
+class FieldChangeTracker
+{
+public:
+	static constexpr uint32_t TileSize      = 32;
+	static constexpr uint32_t MaxDirtyRects = 8;
+
+private:
+	uint32_t _fieldWidth  = 0;
+	uint32_t _fieldHeight = 0;
+	uint32_t _tilesX      = 0;
+	uint32_t _tilesY      = 0;
+
+	std::vector<float> _tilePeak;
+	std::vector<float> _tileChange;
+
+	// 场值变化小于它时输出最多变化一个量化级，由合成查找表决定
+	float _changeThreshold = 1.0f / 255.0f;
+
+	// 合成前场值会被截到这个值（查找表的上限），超出部分的变化看不见
+	float _saturation = FLT_MAX;
+
+	bool _isAllDirty = true;
+
+	// 上次 TakeActivity 以来每个 Pass 前后整场最大值（截断后）的变化之和，用来估计淡出和累积有多快，不是上界
+	// 逐块的上界在注视点抖动跨过块边界时会大幅跳动，整场最大值在注视静止、场饱和后稳定为 0
+	float _activity = 0.0f;
+
+public:
+	// 场尺寸变化或整场重采样后调用，所有块的上界都取 peak，并整体标记为脏
+	void Reset(uint32_t fieldWidth, uint32_t fieldHeight, float peak = 0.0f)
+	{
+		_fieldWidth  = fieldWidth;
+		_fieldHeight = fieldHeight;
+		_tilesX      = (fieldWidth + TileSize - 1) / TileSize;
+		_tilesY      = (fieldHeight + TileSize - 1) / TileSize;
+
+		_tilePeak.assign(static_cast<size_t>(_tilesX) * _tilesY, peak);
+		_tileChange.assign(_tilePeak.size(), 0.0f);
+
+		_isAllDirty = true;
+	}
+
+	// 场被清零: 有内容的块变化量就是它原来的最大值
+	void TrackClear()
+	{
+		auto maxPeak = 0.0f;
+
+		for (size_t i = 0; i < _tilePeak.size(); ++i)
+		{
+			maxPeak = std::max(maxPeak, _tilePeak[i]);
+
+			_tileChange[i] += std::min(_tilePeak[i], _saturation);
+			_tilePeak[i] = 0.0f;
+		}
+
+		_activity += std::min(maxPeak, _saturation);
+	}
+
+	// 一个 Pass: 每个像素乘以 [minFactor, maxFactor] 内的系数，splatRect（场坐标）内再加上不超过 gain 的值
+	void TrackPass(float minFactor, float maxFactor, float gain, const FieldRect& splatRect)
+	{
+		auto scaleChange = std::max(1.0f - minFactor, maxFactor - 1.0f);
+		auto oldMaxPeak  = 0.0f;
+		auto newMaxPeak  = 0.0f;
+
+		FieldRect splatTiles = {};
+		if (!splatRect.IsEmpty())
+			splatTiles = {splatRect.Left / TileSize, splatRect.Top / TileSize, (splatRect.Right - 1) / TileSize + 1, (splatRect.Bottom - 1) / TileSize + 1};
+
+		for (uint32_t tileY = 0; tileY < _tilesY; ++tileY)
+		{
+			for (uint32_t tileX = 0; tileX < _tilesX; ++tileX)
+			{
+				auto index    = static_cast<size_t>(tileY) * _tilesX + tileX;
+				auto isSplat  = tileX >= splatTiles.Left && tileX < splatTiles.Right && tileY >= splatTiles.Top && tileY < splatTiles.Bottom;
+				auto addition = isSplat ? gain : 0.0f;
+
+				// 截断是 1-Lipschitz 的，截断后的变化不超过 min(peak, saturation) * |1 - factor| + min(gain, saturation)
+				_tileChange[index] += std::min(_tilePeak[index], _saturation) * scaleChange + std::min(addition, _saturation);
+
+				oldMaxPeak = std::max(oldMaxPeak, _tilePeak[index]);
+
+				_tilePeak[index] = _tilePeak[index] * maxFactor + addition;
+
+				newMaxPeak = std::max(newMaxPeak, _tilePeak[index]);
+			}
+		}
+
+		_activity += std::fabs(std::min(newMaxPeak, _saturation) - std::min(oldMaxPeak, _saturation));
+	}
+
+	// 没有注视点时的 Solid Pass
+	void TrackDecay(float decay)
+	{
+		TrackPass(decay, decay, 0.0f, {});
+	}
+
+	// 一次 Heatmap/Bubble splat，params 为真实值（惰性衰减的缩放之前）
+	// Bubble 在光圈外会把旧值整片擦掉，系数下界取 0
+	void TrackSplat(const SplatParams& params, bool isBubble)
+	{
+		auto factor = std::clamp(params.Decay, 0.0f, 1.0f);
+		TrackPass(isBubble ? 0.0f : factor, factor, params.Gain, SoftKernels::SplatBounds(params, _fieldWidth, _fieldHeight));
+	}
+
+	// 按合成查找表设置阈值，颜色或形状变化后重新调用
+	void SetCompositeLut(const CompositeLut& lut)
+	{
+		_changeThreshold = SoftKernels::CompositeTolerance(lut);
+		_saturation      = static_cast<float>(CompositeLut::Size - 1) / lut.Scale;
+	}
+
+	// 设置、背景或窗口变化，整张画面都要重新合成
+	void MarkAllDirty() { _isAllDirty = true; }
+
+	// 合成之后调用
+	void MarkClean()
+	{
+		std::fill(_tileChange.begin(), _tileChange.end(), 0.0f);
+		_isAllDirty = false;
+	}
+
+	bool IsAllDirty() const { return _isAllDirty; }
+
+	// 返回上次调用以来场的最大值变化了多少个 8 位量化级并清零，供帧率控制参考
+	// 注视点移动不一定改变最大值，由调用方按注视速度另外判断
+	float TakeActivity()
+	{
+		auto activity = _activity / _changeThreshold;
+		_activity     = 0.0f;
+		return activity;
+	}
+
+	bool IsTileDirty(uint32_t tileX, uint32_t tileY) const
+	{
+		return _isAllDirty || _tileChange[static_cast<size_t>(tileY) * _tilesX + tileX] >= _changeThreshold;
+	}
+
+	bool HasChanges() const
+	{
+		return _isAllDirty || std::any_of(_tileChange.begin(), _tileChange.end(), [this](float change) { return change >= _changeThreshold; });
+	}
+
+	// callback(tileX, tileY)
+	template <typename Callback>
+	void ForEachDirtyTile(Callback&& callback) const
+	{
+		for (uint32_t tileY = 0; tileY < _tilesY; ++tileY)
+		{
+			for (uint32_t tileX = 0; tileX < _tilesX; ++tileX)
+			{
+				if (IsTileDirty(tileX, tileY))
+					callback(tileX, tileY);
+			}
+		}
+	}
+
+	// 超过 maxCount 个矩形时合并成一个包围盒
+	static void CapRects(std::vector<FieldRect>& rects, size_t maxCount)
+	{
+		if (rects.size() <= maxCount)
+			return;
+
+		auto bounds = rects.front();
+
+		for (const auto& rect : rects)
+			bounds = {std::min(bounds.Left, rect.Left), std::min(bounds.Top, rect.Top), std::max(bounds.Right, rect.Right), std::max(bounds.Bottom, rect.Bottom)};
+
+		rects.assign(1, bounds);
+	}
+
+	// 场上 [Left, Right) 的像素经双线性上采样后影响到的输出像素范围，两边各多留一个输出像素抵消浮点误差
+	// 输出像素 x 读取场坐标 c = (x + 0.5) * fieldSize / outputSize - 0.5 处的 floor(c) 和 floor(c) + 1，受影响的是 c ∈ [Left - 1, Right)
+	static FieldRect FieldToOutputRect(const FieldRect& rect, uint32_t fieldWidth, uint32_t fieldHeight, uint32_t outputWidth, uint32_t outputHeight)
+	{
+		auto toOutput = [](double fieldCoordinate, uint32_t fieldSize, uint32_t outputSize)
+		{
+			return (fieldCoordinate + 0.5) * outputSize / fieldSize - 0.5;
+		};
+
+		auto clampBegin = [](double coordinate, uint32_t outputSize) { return static_cast<uint32_t>(std::clamp(std::floor(coordinate) - 1.0, 0.0, static_cast<double>(outputSize))); };
+		auto clampEnd   = [](double coordinate, uint32_t outputSize) { return static_cast<uint32_t>(std::clamp(std::ceil(coordinate) + 1.0, 0.0, static_cast<double>(outputSize))); };
+
+		return
+		{
+			clampBegin(toOutput(rect.Left - 1.0, fieldWidth, outputWidth), outputWidth),
+			clampBegin(toOutput(rect.Top - 1.0, fieldHeight, outputHeight), outputHeight),
+			clampEnd(toOutput(rect.Right, fieldWidth, outputWidth), outputWidth),
+			clampEnd(toOutput(rect.Bottom, fieldHeight, outputHeight), outputHeight),
+		};
+	}
+
+	// 把脏块合并成输出坐标下的矩形追加到 rects: 每行连续的脏块合成一段，与上一行左右边界相同的矩形向下延伸
+	// 结果超过 MaxDirtyRects 个时退化为一个包围盒；全部需要重画时只有一个整屏矩形
+	void CollectDirtyRects(uint32_t outputWidth, uint32_t outputHeight, std::vector<FieldRect>& rects) const
+	{
+		if (_isAllDirty)
+		{
+			rects.push_back({0, 0, outputWidth, outputHeight});
+			return;
+		}
+
+		std::vector<FieldRect> tileRects;
+
+		for (uint32_t tileY = 0; tileY < _tilesY; ++tileY)
+		{
+			for (uint32_t tileX = 0; tileX < _tilesX; ++tileX)
+			{
+				if (!IsTileDirty(tileX, tileY))
+					continue;
+
+				auto spanBegin = tileX;
+				while (tileX + 1 < _tilesX && IsTileDirty(tileX + 1, tileY))
+					++tileX;
+
+				auto pAbove = std::find_if(tileRects.begin(), tileRects.end(), [&](const FieldRect& rect)
+				{
+					return rect.Left == spanBegin && rect.Right == tileX + 1 && rect.Bottom == tileY;
+				});
+
+				if (pAbove != tileRects.end())
+					pAbove->Bottom = tileY + 1;
+				else
+					tileRects.push_back({spanBegin, tileY, tileX + 1, tileY + 1});
+			}
+		}
+
+		CapRects(tileRects, MaxDirtyRects);
+
+		for (const auto& tileRect : tileRects)
+		{
+			FieldRect fieldRect = {tileRect.Left * TileSize, tileRect.Top * TileSize, std::min(tileRect.Right * TileSize, _fieldWidth), std::min(tileRect.Bottom * TileSize, _fieldHeight)};
+			rects.push_back(FieldToOutputRect(fieldRect, _fieldWidth, _fieldHeight, outputWidth, outputHeight));
+		}
+	}
+
+
+	float    GetChangeThreshold() const { return _changeThreshold; }
+	uint32_t GetTilesX() const { return _tilesX; }
+	uint32_t GetTilesY() const { return _tilesY; }
+	uint32_t GetFieldWidth() const { return _fieldWidth; }
+	uint32_t GetFieldHeight() const { return _fieldHeight; }
+};
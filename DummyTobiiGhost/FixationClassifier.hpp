@@ -0,0 +1,215 @@
+﻿#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "Common.h"
+
+
+enum class ClassifierModes
+{
+	Velocity   = 0x0, // I-VT
+	Dispersion = 0x1, // I-DT
+};
+
+enum class GazeEventTypes
+{
+	Unknown  = 0x0,
+	Fixation = 0x1,
+	Saccade  = 0x2,
+};
+
+// 一次注视，时间单位为微秒
+struct FixationEvent
+{
+	Point   Centroid;
+	int64_t Start;
+	int64_t Duration;
+};
+
+struct FixationClassifierParams
+{
+	ClassifierModes Mode = ClassifierModes::Velocity;
+
+	float   VelocityThreshold   = 1000.0f; // 像素/秒，I-VT 低于它算注视
+	float   DispersionThreshold = 100.0f;  // 像素，I-DT 包围盒宽 + 高不超过它算注视
+	int64_t MinFixationDuration = 60000;   // 微秒，更短的注视不输出
+	int64_t VelocityInterval    = 20000;   // 微秒，I-VT 每隔这么久算一次速度，避免高采样率下噪声被放大成速度
+	int64_t MaxSampleGap        = 100000;  // 微秒，采样中断超过它时结束当前注视
+};
+
+
+// 流式注视/扫视分类，每个采样常数时间，不保存采样窗口
+// Velocity  : 与 VelocityInterval 之前的采样比较算速度，低于阈值的连续采样组成一次注视
+// Dispersion: 当前注视的包围盒加上新采样后仍不超过阈值就并入，否则结束当前注视，从这个采样重新开始
+// 注视在结束时（扫视开始、采样无效或中断）通过回调输出，时长不足 MinFixationDuration 的丢弃
+class FixationClassifier
+{
+	FixationClassifierParams _params;
+
+	// 当前注视（或候选注视）的累计值
+	double  _sumX      = 0.0;
+	double  _sumY      = 0.0;
+	int64_t _count     = 0;
+	int64_t _start     = 0;
+	int64_t _last      = 0;
+	Point   _boundsMin = {};
+	Point   _boundsMax = {};
+
+	// I-VT 计算速度用的上一个参考采样
+	GazeSample     _anchor    = {};
+	bool           _hasAnchor = false;
+	GazeEventTypes _label     = GazeEventTypes::Unknown;
+
+	int64_t _previousTimestamp = 0;
+	bool    _hasPrevious       = false;
+
+	bool HasFixation() const { return _count > 0 && _last - _start >= _params.MinFixationDuration; }
+
+	void Accumulate(const GazeSample& sample)
+	{
+		if (_count == 0)
+		{
+			_start     = sample.Timestamp;
+			_boundsMin = sample.Position;
+			_boundsMax = sample.Position;
+		}
+
+		_sumX += sample.Position.X;
+		_sumY += sample.Position.Y;
+		++_count;
+		_last = sample.Timestamp;
+
+		_boundsMin = {std::min(_boundsMin.X, sample.Position.X), std::min(_boundsMin.Y, sample.Position.Y)};
+		_boundsMax = {std::max(_boundsMax.X, sample.Position.X), std::max(_boundsMax.Y, sample.Position.Y)};
+	}
+
+	template <typename Callback>
+	void EndFixation(Callback&& onFixation)
+	{
+		FixationEvent fixation;
+		if (GetCurrentFixation(fixation))
+			onFixation(fixation);
+
+		_sumX  = 0.0;
+		_sumY  = 0.0;
+		_count = 0;
+	}
+
+	float DispersionWith(Point position) const
+	{
+		return std::max(_boundsMax.X, position.X) - std::min(_boundsMin.X, position.X) + std::max(_boundsMax.Y, position.Y) - std::min(_boundsMin.Y, position.Y);
+	}
+
+	template <typename Callback>
+	GazeEventTypes AddVelocitySample(const GazeSample& sample, Callback&& onFixation)
+	{
+		if (!_hasAnchor)
+		{
+			_anchor    = sample;
+			_hasAnchor = true;
+			_label     = GazeEventTypes::Fixation;
+		}
+		else if (sample.Timestamp - _anchor.Timestamp >= _params.VelocityInterval)
+		{
+			auto dx    = sample.Position.X - _anchor.Position.X;
+			auto dy    = sample.Position.Y - _anchor.Position.Y;
+			auto speed = std::sqrt(dx * dx + dy * dy) / (static_cast<float>(sample.Timestamp - _anchor.Timestamp) * 1e-6f);
+
+			_anchor = sample;
+			_label  = speed < _params.VelocityThreshold ? GazeEventTypes::Fixation : GazeEventTypes::Saccade;
+		}
+
+		if (_label == GazeEventTypes::Fixation)
+			Accumulate(sample);
+		else
+			EndFixation(onFixation);
+
+		return _label;
+	}
+
+	template <typename Callback>
+	GazeEventTypes AddDispersionSample(const GazeSample& sample, Callback&& onFixation)
+	{
+		if (_count > 0 && DispersionWith(sample.Position) > _params.DispersionThreshold)
+			EndFixation(onFixation);
+
+		Accumulate(sample);
+
+		// 候选注视还没到最短时长时，它可能只是扫视途中的几个点
+		_label = HasFixation() ? GazeEventTypes::Fixation : GazeEventTypes::Saccade;
+		return _label;
+	}
+
+public:
+	FixationClassifier() = default;
+
+	explicit FixationClassifier(const FixationClassifierParams& params) : _params(params)
+	{
+	}
+
+	void SetParams(const FixationClassifierParams& params)
+	{
+		_params = params;
+		Reset();
+	}
+
+	const FixationClassifierParams& GetParams() const { return _params; }
+
+	// 丢弃当前注视，不输出
+	void Reset()
+	{
+		_sumX      = 0.0;
+		_sumY      = 0.0;
+		_count     = 0;
+		_hasAnchor = false;
+		_label     = GazeEventTypes::Unknown;
+
+		_hasPrevious = false;
+	}
+
+	// 返回这个采样的类别，有注视结束时调用 onFixation(const FixationEvent&)
+	template <typename Callback>
+	GazeEventTypes AddSample(const GazeSample& sample, Callback&& onFixation)
+	{
+		auto isBroken = _hasPrevious && (sample.Timestamp < _previousTimestamp || sample.Timestamp - _previousTimestamp > _params.MaxSampleGap);
+
+		if (!sample.IsValid || isBroken)
+		{
+			EndFixation(onFixation);
+			_hasAnchor   = false;
+			_hasPrevious = false;
+			_label       = GazeEventTypes::Unknown;
+
+			if (!sample.IsValid)
+				return _label;
+		}
+
+		_previousTimestamp = sample.Timestamp;
+		_hasPrevious       = true;
+
+		return _params.Mode == ClassifierModes::Dispersion ? AddDispersionSample(sample, onFixation) : AddVelocitySample(sample, onFixation);
+	}
+
+	// 记录结束时调用，输出还没结束的注视
+	template <typename Callback>
+	void Flush(Callback&& onFixation)
+	{
+		EndFixation(onFixation);
+		_hasAnchor   = false;
+		_hasPrevious = false;
+		_label       = GazeEventTypes::Unknown;
+	}
+
+	// 正在进行且已经达到最短时长的注视
+	bool GetCurrentFixation(FixationEvent& fixation) const
+	{
+		if (!HasFixation())
+			return false;
+
+		fixation = {{static_cast<float>(_sumX / _count), static_cast<float>(_sumY / _count)}, _start, _last - _start};
+		return true;
+	}
+
+	GazeEventTypes GetLabel() const { return _label; }
+};
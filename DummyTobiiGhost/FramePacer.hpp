@@ -0,0 +1,254 @@
+﻿#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+
+// 旧 SDK 里没有这个定义，系统不支持时 CreateWaitableTimerExW 返回 nullptr
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+
+// 系统时钟: Now 为 steady_clock 的微秒数（与 GazeSource::Now 相同），Sleep 只保证不早于请求的时长醒来
+// Windows 上用高精度可等待计时器（Windows 10 1803 起），误差约 0.5 ms，不需要 timeBeginPeriod
+class SteadyPacerClock
+{
+#if defined(_WIN32)
+	HANDLE _timer = nullptr;
+#endif
+
+public:
+	SteadyPacerClock()
+	{
+#if defined(_WIN32)
+		_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+
+		// 不支持高精度计时器时用普通的，精度取决于 timeBeginPeriod
+		if (_timer == nullptr)
+			_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+#endif
+	}
+
+	~SteadyPacerClock()
+	{
+#if defined(_WIN32)
+		if (_timer != nullptr)
+			CloseHandle(_timer);
+#endif
+	}
+
+	SteadyPacerClock(const SteadyPacerClock&)            = delete;
+	SteadyPacerClock& operator=(const SteadyPacerClock&) = delete;
+
+	int64_t Now() const
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void Sleep(int64_t microseconds)
+	{
+#if defined(_WIN32)
+		if (_timer != nullptr)
+		{
+			// 负数表示相对时间，单位 100 ns
+			LARGE_INTEGER dueTime;
+			dueTime.QuadPart = -microseconds * 10;
+
+			if (SetWaitableTimer(_timer, &dueTime, 0, nullptr, nullptr, FALSE))
+			{
+				WaitForSingleObject(_timer, INFINITE);
+				return;
+			}
+		}
+#endif
+		std::this_thread::sleep_for(std::chrono::microseconds(microseconds));
+	}
+
+	// 忙等的最后一段里每次读时钟之间让出时间片，其他线程（例如注视采样线程）仍能在这个核上运行
+	void Spin()
+	{
+		std::this_thread::yield();
+	}
+};
+
+
+// 帧节奏的统计，时间单位为微秒
+struct FramePacerStats
+{
+	uint64_t FrameCount;
+	uint64_t MissedFrameCount; // 醒来时已经晚了一整帧以上，跳过的帧数
+
+	double  MeanLateness; // 实际开始时间比预定的晚多少
+	double  Jitter;       // 晚到时间的标准差
+	int64_t MaxLateness;
+
+	double SpinFraction;  // 忙等占帧间隔的比例，即为了节奏多用的 CPU
+	double SpinThreshold; // 当前提前醒来的余量
+};
+
+
+// 固定间隔的帧节奏: 先睡到截止时间前 SpinThreshold，再忙等到截止时间
+// 每次睡眠后按实际多睡的时间更新估计（均值 + 4 倍平均偏差，与 TCP 估计 RTO 的方法相同），系统计时器越准，忙等越短
+// Clock 需要提供 int64_t Now()（微秒）、void Sleep(int64_t 微秒) 和 void Spin()，测试时可以换成模拟时钟
+template <typename Clock = SteadyPacerClock>
+class FramePacer
+{
+public:
+	static constexpr int64_t MinSpinThreshold = 200;   // 微秒
+	static constexpr int64_t MaxSpinThreshold = 4000;  // 微秒
+	static constexpr double  EstimateGain     = 0.125; // 每次睡眠对估计的权重
+
+private:
+	Clock& _clock;
+
+	int64_t _interval;
+	int64_t _deadline = 0;
+
+	double _oversleepMean      = 1000.0;
+	double _oversleepDeviation = 250.0;
+
+	uint64_t _frameCount       = 0;
+	uint64_t _missedFrameCount = 0;
+	double   _latenessSum      = 0.0;
+	double   _latenessSquares  = 0.0;
+	int64_t  _maxLateness      = 0;
+	int64_t  _spinTime         = 0;
+	int64_t  _pacedTime        = 0;
+
+	int64_t SpinThreshold() const
+	{
+		return std::clamp(static_cast<int64_t>(_oversleepMean + 4.0 * _oversleepDeviation), MinSpinThreshold, MaxSpinThreshold);
+	}
+
+	void TrackOversleep(int64_t oversleep)
+	{
+		auto error = static_cast<double>(oversleep) - _oversleepMean;
+
+		_oversleepMean += EstimateGain * error;
+		_oversleepDeviation += EstimateGain * (std::fabs(error) - _oversleepDeviation);
+	}
+
+public:
+	explicit FramePacer(Clock& clock, double frameRate = 120.0) : _clock(clock),
+	                                                              _interval(std::max<int64_t>(static_cast<int64_t>(1e6 / frameRate), 1))
+	{
+	}
+
+	// 从本帧开始按新的间隔计算下一帧的截止时间，帧率突然升高时下一次 WaitForNextFrame 不会再按旧的间隔等
+	void SetFrameRate(double frameRate)
+	{
+		auto interval = std::max<int64_t>(static_cast<int64_t>(1e6 / frameRate), 1);
+
+		if (_deadline != 0)
+			_deadline += interval - _interval;
+
+		_interval = interval;
+	}
+
+	int64_t GetInterval() const { return _interval; }
+
+	// 等到下一帧的截止时间，返回本帧的时间戳（微秒，即醒来的时刻）
+	// 第一次调用立即返回；落后超过一帧时不补帧，从现在重新开始计时
+	int64_t WaitForNextFrame()
+	{
+		auto now = _clock.Now();
+
+		if (_deadline == 0)
+		{
+			_deadline = now + _interval;
+			return now;
+		}
+
+		auto frameStart = _deadline - _interval;
+
+		if (now < _deadline)
+		{
+			auto spinThreshold = SpinThreshold();
+
+			if (_deadline - now > spinThreshold)
+			{
+				auto wake = _deadline - spinThreshold;
+
+				_clock.Sleep(wake - now);
+				now = _clock.Now();
+
+				TrackOversleep(now - wake);
+			}
+
+			auto spinStart = now;
+
+			while (now < _deadline)
+			{
+				_clock.Spin();
+				now = _clock.Now();
+			}
+
+			_spinTime += now - spinStart;
+		}
+
+		auto lateness = now - _deadline;
+
+		++_frameCount;
+		_latenessSum += static_cast<double>(lateness);
+		_latenessSquares += static_cast<double>(lateness) * static_cast<double>(lateness);
+		_maxLateness = std::max(_maxLateness, lateness);
+		_pacedTime += now - frameStart;
+
+		if (lateness >= _interval)
+		{
+			_missedFrameCount += lateness / _interval;
+			_deadline = now + _interval;
+		}
+		else
+		{
+			_deadline += _interval;
+		}
+
+		return now;
+	}
+
+	FramePacerStats GetStats() const
+	{
+		FramePacerStats stats  = {};
+		stats.FrameCount       = _frameCount;
+		stats.MissedFrameCount = _missedFrameCount;
+		stats.MaxLateness      = _maxLateness;
+		stats.SpinThreshold    = static_cast<double>(SpinThreshold());
+
+		if (_frameCount > 0)
+		{
+			stats.MeanLateness = _latenessSum / static_cast<double>(_frameCount);
+			stats.Jitter       = std::sqrt(std::max(_latenessSquares / static_cast<double>(_frameCount) - stats.MeanLateness * stats.MeanLateness, 0.0));
+		}
+
+		if (_pacedTime > 0)
+			stats.SpinFraction = static_cast<double>(_spinTime) / static_cast<double>(_pacedTime);
+
+		return stats;
+	}
+
+	// 只清统计，保留对睡眠误差的估计
+	void ResetStats()
+	{
+		_frameCount       = 0;
+		_missedFrameCount = 0;
+		_latenessSum      = 0.0;
+		_latenessSquares  = 0.0;
+		_maxLateness      = 0;
+		_spinTime         = 0;
+		_pacedTime        = 0;
+	}
+
+	static void PrintStats(std::ostream& out, const FramePacerStats& stats)
+	{
+		out << "Frame Pacer: " << stats.FrameCount << " frames, " << stats.MissedFrameCount << " missed, late " << stats.MeanLateness << " us (jitter " << stats.Jitter << " us, max "
+			<< stats.MaxLateness << " us), spin " << stats.SpinFraction * 100.0 << "% of frame time, threshold " << stats.SpinThreshold << " us" << std::endl;
+	}
+};
@@ -0,0 +1,495 @@
+﻿#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "Common.h"
+#include "FixationClassifier.hpp"
+
+
+struct GazeGeneratorParams
+{
+	uint64_t Seed       = 1;
+	uint32_t SampleRate = 1200; // 最高 MaxSampleRate
+
+	// 屏幕大小（像素）与每度视角对应的像素数，24 寸 1080p 在 60 cm 处约 40
+	float Width           = 1920.0f;
+	float Height          = 1080.0f;
+	float PixelsPerDegree = 40.0f;
+
+	float NoiseSigma = 4.0f;  // 像素，每个采样的测量噪声
+	float DriftSpeed = 0.25f; // 度/√秒，注视中的漂移（随机游走）
+
+	// 注视时长（微秒）在两者之间，中间值最多
+	int64_t MinFixationDuration = 100000;
+	int64_t MaxFixationDuration = 500000;
+
+	// 扫视幅度（度），时长按 SaccadeDurationSlope * 幅度 + SaccadeDurationIntercept（微秒）
+	float MinSaccadeAmplitude      = 1.0f;
+	float MaxSaccadeAmplitude      = 15.0f;
+	float SaccadeDurationSlope     = 2200.0f;
+	float SaccadeDurationIntercept = 21000.0f;
+
+	// 注视中的微扫视，次/秒与幅度（度）
+	float MicrosaccadeRate      = 1.5f;
+	float MicrosaccadeAmplitude = 0.3f;
+
+	// 扫视之后以匀速平滑追随代替注视的概率，速度为度/秒
+	float PursuitProbability = 0.0f;
+	float PursuitSpeed       = 10.0f;
+
+	// 眨眼与跟踪丢失，次/秒与平均时长（微秒），期间输出无效采样
+	float   BlinkRate     = 0.25f;
+	int64_t BlinkDuration = 150000;
+	float   LossRate      = 0.02f;
+	int64_t LossDuration  = 1000000;
+
+	int64_t StartTimestamp = 0;
+};
+
+
+// 可复现的合成注视轨迹: 注视（漂移 + 微扫视）、按主序列的扫视、可选的平滑追随、眨眼和跟踪丢失
+// 扫视用最小加加速度曲线 10τ³ - 15τ⁴ + 6τ⁵，峰值速度 1.875 * 幅度 / 时长，时长随幅度线性增长，自然落在主序列上
+// 随机数是自己实现的 SplitMix64，正态分布用 12 个均匀分布之和，不依赖标准库分布和 sin/cos/log 的实现，
+// 同一个 Seed 在不同编译器上也产生同样的序列；输出坐标量化到 1/16 像素（与 GazeRecording 相同），
+// 浮点运算顺序上的差异不会改变结果
+// 事件（注视时长、扫视方向和幅度、眨眼等）和每个采样的噪声、漂移各用一个随机数流，同一个 Seed 换采样率时事件序列基本不变
+class GazeGenerator
+{
+public:
+	static constexpr uint32_t MaxSampleRate = 2000;
+
+private:
+	enum class Phases
+	{
+		Fixation,
+		Saccade,
+		Pursuit,
+		Blink,
+		Loss,
+	};
+
+	struct Random
+	{
+		uint64_t State;
+
+		uint64_t Next()
+		{
+			auto z = State += 0x9E3779B97F4A7C15ull;
+			z      = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z      = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		// [0, 1)
+		double Uniform() { return static_cast<double>(Next() >> 11) * (1.0 / 9007199254740992.0); }
+
+		double Uniform(double min, double max) { return min + (max - min) * Uniform(); }
+
+		// 近似标准正态，范围 ±6
+		double Normal()
+		{
+			auto sum = 0.0;
+			for (auto i = 0; i < 12; ++i)
+				sum += Uniform();
+			return sum - 6.0;
+		}
+
+		// 均值为 mean 的等待时间，[0, 2 * mean) 上均匀分布
+		int64_t Interval(double mean) { return static_cast<int64_t>(2.0 * mean * Uniform()); }
+
+		// 单位圆内拒绝采样后归一化的随机方向
+		void Direction(double& x, double& y)
+		{
+			for (;;)
+			{
+				x = Uniform(-1.0, 1.0);
+				y = Uniform(-1.0, 1.0);
+
+				auto r = x * x + y * y;
+
+				if (r > 1e-4 && r <= 1.0)
+				{
+					auto length = std::sqrt(r);
+
+					x /= length;
+					y /= length;
+					return;
+				}
+			}
+		}
+	};
+
+	GazeGeneratorParams _params;
+
+	Random _events = {};
+	Random _noise  = {};
+
+	uint64_t _index      = 0;
+	int64_t  _time       = 0; // 相对 StartTimestamp
+	uint32_t _rate       = 0;
+	Phases   _phase      = Phases::Fixation;
+	int64_t  _phaseStart = 0;
+	int64_t  _phaseEnd   = 0;
+	int64_t  _nextBlink  = 0;
+	int64_t  _nextLoss   = 0;
+
+	// 注视中心与漂移，单位像素
+	double _centerX = 0.0;
+	double _centerY = 0.0;
+	double _driftX  = 0.0;
+	double _driftY  = 0.0;
+
+	// 当前扫视（或微扫视）的起止点与时间
+	double  _fromX       = 0.0;
+	double  _fromY       = 0.0;
+	double  _toX         = 0.0;
+	double  _toY         = 0.0;
+	int64_t _motionStart = 0;
+	int64_t _motionEnd   = 0;
+
+	int64_t _nextMicrosaccade = 0;
+	bool    _isMicrosaccade   = false;
+	double  _pursuitVelocityX = 0.0;
+	double  _pursuitVelocityY = 0.0;
+	int64_t _lastTime         = 0;
+
+	static double MinimumJerk(double t)
+	{
+		return t * t * t * (10.0 + t * (-15.0 + t * 6.0));
+	}
+
+	static float Quantize(double value)
+	{
+		return static_cast<float>(std::floor(value * 16.0 + 0.5) / 16.0);
+	}
+
+	double Margin() const { return _params.PixelsPerDegree; }
+
+	int64_t FixationDuration()
+	{
+		auto t = (_events.Uniform() + _events.Uniform()) * 0.5;
+		return _params.MinFixationDuration + static_cast<int64_t>(static_cast<double>(_params.MaxFixationDuration - _params.MinFixationDuration) * t);
+	}
+
+	// from 之后下一次事件的时间，rate 为 0 时永不发生
+	int64_t NextEvent(int64_t from, float rate)
+	{
+		return rate > 0.0f ? from + _events.Interval(1e6 / rate) : INT64_MAX;
+	}
+
+	// 眨眼前漂移到的位置作为新的注视中心
+	void StartFixation(int64_t time)
+	{
+		_centerX += _driftX;
+		_centerY += _driftY;
+
+		_phase            = Phases::Fixation;
+		_phaseStart       = time;
+		_phaseEnd         = time + FixationDuration();
+		_driftX           = 0.0;
+		_driftY           = 0.0;
+		_isMicrosaccade   = false;
+		_nextMicrosaccade = NextEvent(time, _params.MicrosaccadeRate);
+	}
+
+	// 从当前位置扫视到一个随机方向、随机幅度的目标，碰到屏幕边缘时反射回来
+	void StartSaccade(int64_t time)
+	{
+		double directionX, directionY;
+		_events.Direction(directionX, directionY);
+		auto amplitude = _events.Uniform(_params.MinSaccadeAmplitude, _params.MaxSaccadeAmplitude);
+
+		auto reflect = [this](double value, double size)
+		{
+			auto margin = std::min(Margin(), size * 0.25);
+			auto low    = margin;
+			auto high   = size - margin;
+
+			if (value < low)
+				value = low + (low - value);
+			if (value > high)
+				value = high - (value - high);
+
+			return std::clamp(value, low, high);
+		};
+
+		_fromX = _centerX + _driftX;
+		_fromY = _centerY + _driftY;
+		_toX   = reflect(_fromX + directionX * amplitude * _params.PixelsPerDegree, _params.Width);
+		_toY   = reflect(_fromY + directionY * amplitude * _params.PixelsPerDegree, _params.Height);
+
+		auto dx      = _toX - _fromX;
+		auto dy      = _toY - _fromY;
+		auto degrees = std::sqrt(dx * dx + dy * dy) / _params.PixelsPerDegree;
+
+		_phase       = Phases::Saccade;
+		_phaseStart  = time;
+		_motionStart = time;
+		_motionEnd   = time + std::max<int64_t>(static_cast<int64_t>(_params.SaccadeDurationSlope * degrees + _params.SaccadeDurationIntercept), 1);
+		_phaseEnd    = _motionEnd;
+	}
+
+	void StartPursuit(int64_t time)
+	{
+		double directionX, directionY;
+		_events.Direction(directionX, directionY);
+		auto speed     = _params.PursuitSpeed * _params.PixelsPerDegree;
+
+		_phase            = Phases::Pursuit;
+		_phaseStart       = time;
+		_phaseEnd         = time + FixationDuration();
+		_driftX           = 0.0;
+		_driftY           = 0.0;
+		_pursuitVelocityX = directionX * speed * 1e-6;
+		_pursuitVelocityY = directionY * speed * 1e-6;
+	}
+
+	// 眨眼或跟踪丢失只打断注视和平滑追随，扫视途中到期的推迟到扫视结束
+	void StartInterruption(int64_t time)
+	{
+		auto isLoss = _nextLoss <= _nextBlink;
+
+		_phase      = isLoss ? Phases::Loss : Phases::Blink;
+		_phaseStart = time;
+		_phaseEnd   = time + std::max<int64_t>(_events.Interval(static_cast<double>(isLoss ? _params.LossDuration : _params.BlinkDuration)), 1);
+
+		// 另一种在这期间到期的也推迟到结束之后
+		if (isLoss)
+		{
+			_nextLoss  = NextEvent(_phaseEnd, _params.LossRate);
+			_nextBlink = std::max(_nextBlink, _phaseEnd);
+		}
+		else
+		{
+			_nextBlink = NextEvent(_phaseEnd, _params.BlinkRate);
+			_nextLoss  = std::max(_nextLoss, _phaseEnd);
+		}
+	}
+
+	void EndPhase()
+	{
+		auto time = _phaseEnd;
+
+		switch (_phase)
+		{
+			case Phases::Fixation:
+			case Phases::Pursuit:
+				// 进行中的微扫视按已经走过的部分并入漂移
+				if (_isMicrosaccade)
+				{
+					auto progress = MotionProgress(time);
+
+					_driftX += (_toX - _fromX) * progress;
+					_driftY += (_toY - _fromY) * progress;
+				}
+
+				StartSaccade(time);
+				break;
+
+			case Phases::Saccade:
+				_centerX = _toX;
+				_centerY = _toY;
+				_driftX  = 0.0;
+				_driftY  = 0.0;
+
+				if (_events.Uniform() < _params.PursuitProbability)
+					StartPursuit(time);
+				else
+					StartFixation(time);
+				break;
+
+			case Phases::Blink:
+				StartFixation(time);
+				break;
+
+			case Phases::Loss:
+				// 丢失期间视线去了别处，从一个新的位置重新开始
+				_centerX = _events.Uniform(Margin(), _params.Width - Margin());
+				_centerY = _events.Uniform(Margin(), _params.Height - Margin());
+				_driftX  = 0.0;
+				_driftY  = 0.0;
+				StartFixation(time);
+				break;
+		}
+	}
+
+	// 把时间推进到 time，按先后处理期间到期的事件
+	void Advance(int64_t time)
+	{
+		auto elapsed = time - _lastTime;
+		_lastTime    = time;
+
+		for (;;)
+		{
+			auto isLooking    = _phase == Phases::Fixation || _phase == Phases::Pursuit;
+			auto interruption = isLooking ? std::max(std::min(_nextBlink, _nextLoss), _phaseStart) : INT64_MAX;
+
+			if (interruption <= time && interruption < _phaseEnd)
+			{
+				StartInterruption(interruption);
+				continue;
+			}
+
+			if (time < _phaseEnd)
+				break;
+
+			EndPhase();
+		}
+
+		if (_phase == Phases::Fixation || _phase == Phases::Pursuit)
+		{
+			// 漂移是随机游走，步长与 √dt 成正比
+			auto step = _params.DriftSpeed * _params.PixelsPerDegree * std::sqrt(static_cast<double>(elapsed) * 1e-6);
+
+			_driftX += _noise.Normal() * step;
+			_driftY += _noise.Normal() * step;
+		}
+
+		if (_phase == Phases::Pursuit)
+		{
+			auto distance = static_cast<double>(std::min(elapsed, time - _phaseStart));
+
+			_centerX = std::clamp(_centerX + _pursuitVelocityX * distance, 0.0, static_cast<double>(_params.Width));
+			_centerY = std::clamp(_centerY + _pursuitVelocityY * distance, 0.0, static_cast<double>(_params.Height));
+		}
+
+		if (_phase != Phases::Fixation)
+			return;
+
+		if (_isMicrosaccade && time >= _motionEnd)
+		{
+			_isMicrosaccade = false;
+			_driftX += _toX - _fromX;
+			_driftY += _toY - _fromY;
+		}
+
+		if (!_isMicrosaccade && time >= _nextMicrosaccade)
+		{
+			double directionX, directionY;
+			_events.Direction(directionX, directionY);
+			auto amplitude = _params.MicrosaccadeAmplitude * _events.Uniform(0.5, 1.5);
+
+			_isMicrosaccade   = true;
+			_fromX            = 0.0;
+			_fromY            = 0.0;
+			_toX              = directionX * amplitude * _params.PixelsPerDegree;
+			_toY              = directionY * amplitude * _params.PixelsPerDegree;
+			_motionStart      = _nextMicrosaccade;
+			_motionEnd        = _nextMicrosaccade + std::max<int64_t>(static_cast<int64_t>(_params.SaccadeDurationSlope * amplitude + _params.SaccadeDurationIntercept * 0.5f), 1);
+			_nextMicrosaccade = NextEvent(_motionEnd, _params.MicrosaccadeRate);
+		}
+	}
+
+	double MotionProgress(int64_t time) const
+	{
+		auto t = static_cast<double>(time - _motionStart) / static_cast<double>(_motionEnd - _motionStart);
+		return MinimumJerk(std::clamp(t, 0.0, 1.0));
+	}
+
+public:
+	explicit GazeGenerator(const GazeGeneratorParams& params = {})
+	{
+		Reset(params);
+	}
+
+	void Reset(const GazeGeneratorParams& params)
+	{
+		_params = params;
+		_rate   = std::clamp(params.SampleRate, 1u, MaxSampleRate);
+
+		// 两个流的种子错开，互不相关
+		_events = {params.Seed};
+		_noise  = {params.Seed ^ 0xD1B54A32D192ED03ull};
+
+		_index    = 0;
+		_time     = 0;
+		_lastTime = 0;
+
+		_centerX = params.Width * 0.5;
+		_centerY = params.Height * 0.5;
+		_driftX  = 0.0;
+		_driftY  = 0.0;
+
+		_nextBlink = NextEvent(0, params.BlinkRate);
+		_nextLoss  = NextEvent(0, params.LossRate);
+
+		StartFixation(0);
+	}
+
+	const GazeGeneratorParams& GetParams() const { return _params; }
+
+	// 下一个采样，时间戳为 StartTimestamp + index * 1e6 / SampleRate（整数运算，不累积误差）
+	GazeSample Next()
+	{
+		_time = static_cast<int64_t>(_index * 1000000 / _rate);
+		++_index;
+
+		Advance(_time);
+
+		auto timestamp = _params.StartTimestamp + _time;
+
+		if (_phase == Phases::Blink || _phase == Phases::Loss)
+			return {timestamp, {}, false};
+
+		auto x = _centerX + _driftX;
+		auto y = _centerY + _driftY;
+
+		if (_phase == Phases::Saccade)
+		{
+			auto progress = MotionProgress(_time);
+
+			x = _fromX + (_toX - _fromX) * progress;
+			y = _fromY + (_toY - _fromY) * progress;
+		}
+		else if (_isMicrosaccade)
+		{
+			auto progress = MotionProgress(_time);
+
+			x += _fromX + (_toX - _fromX) * progress;
+			y += _fromY + (_toY - _fromY) * progress;
+		}
+
+		x += _noise.Normal() * _params.NoiseSigma;
+		y += _noise.Normal() * _params.NoiseSigma;
+
+		return {timestamp, {Quantize(x), Quantize(y)}, true};
+	}
+
+	// 当前采样的真实类别，无效采样为 Unknown，微扫视和平滑追随算作注视
+	GazeEventTypes GetLabel() const
+	{
+		switch (_phase)
+		{
+			case Phases::Fixation:
+			case Phases::Pursuit:
+				return GazeEventTypes::Fixation;
+
+			case Phases::Saccade:
+				return GazeEventTypes::Saccade;
+
+			default:
+				return GazeEventTypes::Unknown;
+		}
+	}
+
+	void Generate(std::vector<GazeSample>& samples, double seconds)
+	{
+		auto count = static_cast<size_t>(seconds * _rate);
+
+		samples.reserve(samples.size() + count);
+
+		for (size_t i = 0; i < count; ++i)
+			samples.push_back(Next());
+	}
+
+	static std::vector<GazeSample> Generate(const GazeGeneratorParams& params, double seconds)
+	{
+		std::vector<GazeSample> samples;
+
+		GazeGenerator generator(params);
+		generator.Generate(samples, seconds);
+		return samples;
+	}
+};
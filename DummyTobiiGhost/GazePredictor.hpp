@@ -0,0 +1,357 @@
+﻿#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Common.h"
+
+
+enum class PredictionModes
+{
+	None   = 0x0,
+	Kalman = 0x2, // 0x1 是去掉的 ConstantVelocity，旧记录里的这个值按 None 处理
+};
+
+// 回放一段记录时预测误差的统计，单位为像素
+struct PredictionError
+{
+	double Mean;
+	double Rms;
+	double P95;
+	double Max;
+	size_t Count;
+};
+
+
+// 把注视点外推到画面实际显示的时间，抵消眼动仪、渲染和显示的延迟
+// 每个轴一个 [位置, 速度] 的 Kalman 匀速模型，加速度当作白噪声，按滤波速度把眼动分成注视、平滑追随和扫视:
+//   速度低于 FixationSpeed 且持续 FixationSettleTime 为注视，取滤波后的位置压住采样噪声
+//   介于两者之间且持续 MinPursuitTime 为追随，按滤波速度外推
+//   超过 MaxPursuitSpeed 为扫视；刚开始或刚结束扫视时两边都不算，直接用最新位置
+// 用差分速度外推（ConstantVelocity）在回放基准里始终不如不预测，已经去掉
+// 扫视的落点无法从速度推出来，全速外推会冲过头，只按 SaccadeGain 外推 MaxSaccadeHorizon 以内
+// 最新采样偏离滤波位置超过 BlendStartSigma 倍噪声时逐渐改用最新采样，超过 BlendEndSigma 倍按扫视处理，不让滤波的滞后拖慢扫视的起步
+// 采样无效或间隔超过 MaxSampleGap 时重新开始；外推时长不超过 MaxHorizon
+class GazePredictor
+{
+public:
+	static constexpr int64_t  SaccadeVelocityWindow = 10000;  // 微秒，120 Hz 时正好包含上一个采样
+	static constexpr int64_t  MaxSampleGap          = 100000; // 微秒
+	static constexpr int64_t  MaxHorizon            = 100000; // 微秒
+	static constexpr int64_t  MaxSaccadeHorizon     = 8000;   // 微秒
+	static constexpr int64_t  MinPursuitTime        = 50000;  // 微秒
+	static constexpr int64_t  FixationSettleTime    = 30000;  // 微秒
+	static constexpr uint32_t HistorySize           = 64;
+
+	// 像素/秒
+	static constexpr float FixationSpeed   = 100.0f;
+	static constexpr float MaxPursuitSpeed = 1500.0f;
+	static constexpr float SaccadeGain     = 0.3f;
+
+	// 像素²，与回放基准里 5 像素的采样噪声一致
+	static constexpr double MeasurementVariance = 25.0;
+	// 像素²/秒³，加速度白噪声的功率谱密度；追随的速度变化很慢，取小一些注视时才压得住噪声
+	static constexpr double AccelerationDensity = 1e4;
+	static constexpr double OutlierSigma        = 4.0;
+	static constexpr double BlendStartSigma     = 1.0;
+	static constexpr double BlendEndSigma       = 3.0;
+
+private:
+	struct AxisFilter
+	{
+		double Position;
+		double Velocity;
+		double P00;
+		double P01;
+		double P11;
+
+		void Reset(double position)
+		{
+			Position = position;
+			Velocity = 0.0;
+			P00      = MeasurementVariance;
+			P01      = 0.0;
+			P11      = 1e6;
+		}
+
+		// 新息超出 OutlierSigma 倍标准差时返回 false
+		bool Update(double measurement, double dt)
+		{
+			// 预测: x = F x，P = F P Fᵀ + Q
+			Position += Velocity * dt;
+
+			auto dt2 = dt * dt;
+			auto p00 = P00 + 2.0 * dt * P01 + dt2 * P11 + AccelerationDensity * dt2 * dt / 3.0;
+			auto p01 = P01 + dt * P11 + AccelerationDensity * dt2 / 2.0;
+			auto p11 = P11 + AccelerationDensity * dt;
+
+			// 更新: 只观测位置
+			auto s  = p00 + MeasurementVariance;
+			auto k0 = p00 / s;
+			auto k1 = p01 / s;
+			auto y  = measurement - Position;
+
+			// 新息超出 OutlierSigma 倍标准差说明是扫视，模型不再适用，直接从新位置重新开始
+			if (y * y > OutlierSigma * OutlierSigma * s)
+			{
+				Reset(measurement);
+				return false;
+			}
+
+			Position += k0 * y;
+			Velocity += k1 * y;
+
+			P00 = (1.0 - k0) * p00;
+			P01 = (1.0 - k0) * p01;
+			P11 = p11 - k1 * p01;
+			return true;
+		}
+	};
+
+	PredictionModes _mode = PredictionModes::None;
+
+	GazeSample _history[HistorySize] = {};
+	uint32_t   _historyCount         = 0;
+	uint32_t   _historyEnd           = 0;
+
+	AxisFilter _filterX = {};
+	AxisFilter _filterY = {};
+
+	// 微秒，按滤波速度连续处于追随 / 注视的时长
+	int64_t _pursuitTime  = 0;
+	int64_t _fixationTime = 0;
+
+	const GazeSample& HistoryAt(uint32_t age) const
+	{
+		return _history[(_historyEnd + HistorySize - 1 - age) % HistorySize];
+	}
+
+	// 最近 window 微秒内首尾两个采样的速度（像素/秒），窗口内只有一个采样时返回 false
+	bool WindowVelocity(int64_t window, Point& velocity) const
+	{
+		const auto& latest = HistoryAt(0);
+
+		// 窗口内最早的一个采样
+		auto oldest = 0u;
+		while (oldest + 1 < _historyCount && latest.Timestamp - HistoryAt(oldest + 1).Timestamp <= window)
+			++oldest;
+
+		if (oldest == 0)
+			return false;
+
+		const auto& first = HistoryAt(oldest);
+
+		auto span = static_cast<float>(latest.Timestamp - first.Timestamp) * 1e-6f;
+
+		velocity = {(latest.Position.X - first.Position.X) / span, (latest.Position.Y - first.Position.Y) / span};
+		return true;
+	}
+
+	static Point Extrapolate(Point position, Point velocity, int64_t horizon)
+	{
+		auto dt = static_cast<float>(horizon) * 1e-6f;
+		return {position.X + velocity.X * dt, position.Y + velocity.Y * dt};
+	}
+
+	bool IsSaccade() const
+	{
+		return _filterX.Velocity * _filterX.Velocity + _filterY.Velocity * _filterY.Velocity >= static_cast<double>(MaxPursuitSpeed) * MaxPursuitSpeed;
+	}
+
+	Point SaccadePredict(int64_t horizon) const
+	{
+		const auto& latest = HistoryAt(0);
+
+		Point velocity;
+		if (!WindowVelocity(SaccadeVelocityWindow, velocity))
+			return latest.Position;
+
+		return Extrapolate(latest.Position, {velocity.X * SaccadeGain, velocity.Y * SaccadeGain}, std::min(horizon, MaxSaccadeHorizon));
+	}
+
+	Point KalmanPredict(int64_t horizon) const
+	{
+		const auto& latest = HistoryAt(0);
+
+		Point filtered = {static_cast<float>(_filterX.Position), static_cast<float>(_filterY.Position)};
+		Point offset   = {latest.Position.X - filtered.X, latest.Position.Y - filtered.Y};
+
+		// 最新采样偏离滤波位置的程度，以采样噪声的标准差计
+		auto deviation = std::sqrt((static_cast<double>(offset.X) * offset.X + static_cast<double>(offset.Y) * offset.Y) / MeasurementVariance);
+
+		if (IsSaccade() || deviation > BlendEndSigma)
+			return SaccadePredict(horizon);
+
+		Point estimate;
+		if (_pursuitTime >= MinPursuitTime)
+			estimate = Extrapolate(filtered, {static_cast<float>(_filterX.Velocity), static_cast<float>(_filterY.Velocity)}, horizon);
+		else if (_fixationTime >= FixationSettleTime)
+			estimate = filtered;
+		else
+			return latest.Position;
+
+		auto weight = static_cast<float>(std::clamp((deviation - BlendStartSigma) / (BlendEndSigma - BlendStartSigma), 0.0, 1.0));
+		return {estimate.X + offset.X * weight, estimate.Y + offset.Y * weight};
+	}
+
+public:
+	void SetMode(PredictionModes mode)
+	{
+		_mode = mode;
+		Reset();
+	}
+
+	PredictionModes GetMode() const { return _mode; }
+
+	void Reset()
+	{
+		_historyCount = 0;
+		_historyEnd   = 0;
+		_pursuitTime  = 0;
+		_fixationTime = 0;
+	}
+
+	bool HasSamples() const { return _historyCount > 0; }
+
+	void AddSample(const GazeSample& sample)
+	{
+		if (!sample.IsValid)
+		{
+			Reset();
+			return;
+		}
+
+		if (_historyCount > 0 && (sample.Timestamp <= HistoryAt(0).Timestamp || sample.Timestamp - HistoryAt(0).Timestamp > MaxSampleGap))
+		{
+			// 时间倒退或中断太久，之前的速度没有意义
+			if (sample.Timestamp - HistoryAt(0).Timestamp > MaxSampleGap || sample.Timestamp < HistoryAt(0).Timestamp)
+				Reset();
+			else
+				return;
+		}
+
+		if (_mode == PredictionModes::Kalman)
+		{
+			if (_historyCount == 0)
+			{
+				_filterX.Reset(sample.Position.X);
+				_filterY.Reset(sample.Position.Y);
+			}
+			else
+			{
+				auto interval = sample.Timestamp - HistoryAt(0).Timestamp;
+				auto dt       = static_cast<double>(interval) * 1e-6;
+
+				auto isInlierX = _filterX.Update(sample.Position.X, dt);
+				auto isInlierY = _filterY.Update(sample.Position.Y, dt);
+
+				if (!isInlierX || !isInlierY)
+				{
+					_pursuitTime  = 0;
+					_fixationTime = 0;
+				}
+				else
+				{
+					auto speed = std::sqrt(_filterX.Velocity * _filterX.Velocity + _filterY.Velocity * _filterY.Velocity);
+
+					_pursuitTime  = speed > FixationSpeed && speed < MaxPursuitSpeed ? _pursuitTime + interval : 0;
+					_fixationTime = speed <= FixationSpeed ? _fixationTime + interval : 0;
+				}
+			}
+		}
+
+		_history[_historyEnd] = sample;
+		_historyEnd           = (_historyEnd + 1) % HistorySize;
+		_historyCount         = std::min(_historyCount + 1, HistorySize);
+	}
+
+	// timestamp 时刻（微秒）的注视点，没有有效采样时返回 false
+	bool Predict(int64_t timestamp, Point& point) const
+	{
+		if (_historyCount == 0)
+			return false;
+
+		const auto& latest = HistoryAt(0);
+
+		auto horizon = std::clamp(timestamp - latest.Timestamp, int64_t{0}, MaxHorizon);
+
+		switch (_mode)
+		{
+			case PredictionModes::Kalman:
+				point = KalmanPredict(horizon);
+				break;
+
+			default:
+				point = latest.Position;
+				break;
+		}
+
+		return true;
+	}
+
+	// 按记录回放: 每收到一个采样就预测 horizon 微秒之后的位置，与记录里那个时刻的位置（前后两个有效采样线性插值）比较
+	// 预测目标跨过无效采样或超出记录末尾时不计入
+	static PredictionError Evaluate(const GazeSample* pSamples, size_t count, PredictionModes mode, int64_t horizon)
+	{
+		GazePredictor predictor;
+		predictor.SetMode(mode);
+
+		std::vector<double> errors;
+		size_t              truthIndex = 0;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			predictor.AddSample(pSamples[i]);
+
+			Point predicted;
+			if (!predictor.Predict(pSamples[i].Timestamp + horizon, predicted))
+				continue;
+
+			auto target = pSamples[i].Timestamp + horizon;
+
+			truthIndex = std::max(truthIndex, i);
+			while (truthIndex + 1 < count && pSamples[truthIndex + 1].Timestamp < target)
+				++truthIndex;
+
+			if (truthIndex + 1 >= count)
+				break;
+
+			const auto& before = pSamples[truthIndex];
+			const auto& after  = pSamples[truthIndex + 1];
+
+			if (!before.IsValid || !after.IsValid)
+				continue;
+
+			auto t  = static_cast<float>(target - before.Timestamp) / static_cast<float>(after.Timestamp - before.Timestamp);
+			auto dx = predicted.X - (before.Position.X + (after.Position.X - before.Position.X) * t);
+			auto dy = predicted.Y - (before.Position.Y + (after.Position.Y - before.Position.Y) * t);
+
+			errors.push_back(std::sqrt(static_cast<double>(dx) * dx + static_cast<double>(dy) * dy));
+		}
+
+		PredictionError result = {};
+		result.Count           = errors.size();
+
+		if (errors.empty())
+			return result;
+
+		auto sum        = 0.0;
+		auto sumSquares = 0.0;
+
+		for (auto error : errors)
+		{
+			sum += error;
+			sumSquares += error * error;
+		}
+
+		std::sort(errors.begin(), errors.end());
+
+		result.Mean = sum / errors.size();
+		result.Rms  = std::sqrt(sumSquares / errors.size());
+		result.P95  = errors[std::min(errors.size() - 1, errors.size() * 95 / 100)];
+		result.Max  = errors.back();
+		return result;
+	}
+};
@@ -0,0 +1,544 @@
+﻿#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Common.h"
+#include "TobiiRenderData.hpp"
+
+
+// 注视记录文件: 文件头之后是一个个独立的块，块头带 CRC32，单个块损坏不影响其他块
+// 块内每条记录以 varint(zigzag(dt) << 2 | Kind) 开头，dt 是与上一条记录的时间差（微秒）
+// 坐标按 1 / CoordinateScale 像素定点化后与上一个采样做差，zigzag 后写成 varint
+// 每个块的差分都从 0 开始，可以单独解码；设置记录带长度前缀，以后增加字段时旧的读取端可以跳过
+namespace GazeRecording
+{
+	static constexpr uint32_t FileMagic       = 0x43524754; // "TGRC"
+	static constexpr uint32_t BlockMagic      = 0x4B4C4247; // "GBLK"
+	static constexpr uint32_t Version         = 1;
+	static constexpr uint32_t CoordinateScale = 16;
+	static constexpr size_t   MaxPayloadSize  = 64 * 1024;
+	static constexpr size_t   BlockHeaderSize = 16;
+	static constexpr size_t   FileHeaderSize  = 12;
+
+	enum RecordKinds : uint32_t
+	{
+		SampleRecord        = 0x0,
+		InvalidSampleRecord = 0x1,
+		SettingsRecord      = 0x2,
+	};
+
+	static uint32_t Crc32(const uint8_t* pData, size_t size)
+	{
+		static const auto table = []
+		{
+			std::array<uint32_t, 256> entries = {};
+
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				auto crc = i;
+
+				for (auto bit = 0; bit < 8; ++bit)
+					crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+
+				entries[i] = crc;
+			}
+
+			return entries;
+		}();
+
+		auto crc = 0xFFFFFFFFu;
+
+		for (size_t i = 0; i < size; ++i)
+			crc = table[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+
+		return ~crc;
+	}
+
+	static uint64_t ZigZag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+	static int64_t  UnZigZag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+	static constexpr size_t MaxVarintSize = 10;
+
+	// 调用方保证 p 之后至少有 MaxVarintSize 字节，返回写完之后的位置
+	static uint8_t* WriteVarint(uint8_t* p, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			*p++ = static_cast<uint8_t>(value | 0x80);
+			value >>= 7;
+		}
+
+		*p++ = static_cast<uint8_t>(value);
+		return p;
+	}
+
+	static void WriteVarint(std::vector<uint8_t>& out, uint64_t value)
+	{
+		uint8_t bytes[MaxVarintSize];
+		out.insert(out.end(), bytes, WriteVarint(bytes, value));
+	}
+
+	// 越界或超过 10 字节时返回 false
+	static bool ReadVarint(const uint8_t*& p, const uint8_t* pEnd, uint64_t& value)
+	{
+		value = 0;
+
+		for (auto shift = 0; shift < 64 && p < pEnd; shift += 7)
+		{
+			auto byte = *p++;
+			value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+			if ((byte & 0x80) == 0)
+				return true;
+		}
+
+		return false;
+	}
+
+	static void WriteU32(uint8_t* p, uint32_t value)
+	{
+		for (auto i = 0; i < 4; ++i)
+			p[i] = static_cast<uint8_t>(value >> (i * 8));
+	}
+
+	static uint32_t ReadU32(const uint8_t* p)
+	{
+		return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+	}
+
+	static int32_t ToFixed(float coordinate)
+	{
+		return static_cast<int32_t>(std::lround(coordinate * static_cast<float>(CoordinateScale)));
+	}
+
+	static float FromFixed(int64_t coordinate)
+	{
+		return static_cast<float>(coordinate) / static_cast<float>(CoordinateScale);
+	}
+
+#pragma region Settings
+	// 按字段顺序写入，新字段只能加在末尾
+	static void WriteSettings(std::vector<uint8_t>& out, const TobiiRenderSettings& settings)
+	{
+		std::vector<uint8_t> fields;
+
+		auto writeFloat = [&](float value)
+		{
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+
+			uint8_t bytes[4];
+			WriteU32(bytes, bits);
+			fields.insert(fields.end(), bytes, bytes + 4);
+		};
+
+		auto writeColor = [&](const OverlayColor& color)
+		{
+			writeFloat(color.R);
+			writeFloat(color.G);
+			writeFloat(color.B);
+			writeFloat(color.A);
+		};
+
+		writeColor(settings.Color);
+		writeColor(settings.BackgroundColor);
+		fields.push_back(static_cast<uint8_t>(settings.ShapeType));
+		writeFloat(settings.Size);
+		writeFloat(settings.Trail);
+		writeFloat(settings.Decay);
+		writeFloat(settings.Responsiveness);
+		fields.push_back(settings.Enable ? 1 : 0);
+		fields.push_back(static_cast<uint8_t>(settings.SmoothingMode));
+		fields.push_back(settings.HeatmapFixationsOnly ? 1 : 0);
+		fields.push_back(static_cast<uint8_t>(settings.FixationClassifier));
+		fields.push_back(settings.TimeBasedDecay ? 1 : 0);
+		fields.push_back(static_cast<uint8_t>(settings.PredictionMode));
+		writeFloat(settings.PredictionLatency);
+
+		WriteVarint(out, fields.size());
+		out.insert(out.end(), fields.begin(), fields.end());
+	}
+
+	// 记录里没有的字段保持默认值，多出来的字段忽略
+	static bool ReadSettings(const uint8_t*& p, const uint8_t* pEnd, TobiiRenderSettings& settings)
+	{
+		uint64_t size;
+		if (!ReadVarint(p, pEnd, size) || size > static_cast<uint64_t>(pEnd - p))
+			return false;
+
+		auto pField    = p;
+		auto pFieldEnd = p + size;
+		p              = pFieldEnd;
+
+		settings = {};
+
+		// 字段读完后保持默认值
+		auto readByte = [&](uint8_t fallback) -> uint8_t
+		{
+			return pField < pFieldEnd ? *pField++ : fallback;
+		};
+
+		auto readFloat = [&](float& value)
+		{
+			if (pFieldEnd - pField < 4)
+				return;
+
+			auto bits = ReadU32(pField);
+			memcpy(&value, &bits, sizeof(value));
+			pField += 4;
+		};
+
+		auto readColor = [&](OverlayColor& color)
+		{
+			readFloat(color.R);
+			readFloat(color.G);
+			readFloat(color.B);
+			readFloat(color.A);
+		};
+
+		readColor(settings.Color);
+		readColor(settings.BackgroundColor);
+		settings.ShapeType = static_cast<ShapeTypes>(readByte(static_cast<uint8_t>(settings.ShapeType)));
+		readFloat(settings.Size);
+		readFloat(settings.Trail);
+		readFloat(settings.Decay);
+		readFloat(settings.Responsiveness);
+		settings.Enable               = readByte(settings.Enable ? 1 : 0) != 0;
+		settings.SmoothingMode        = static_cast<SmoothingModes>(readByte(static_cast<uint8_t>(settings.SmoothingMode)));
+		settings.HeatmapFixationsOnly = readByte(settings.HeatmapFixationsOnly ? 1 : 0) != 0;
+		settings.FixationClassifier   = static_cast<ClassifierModes>(readByte(static_cast<uint8_t>(settings.FixationClassifier)));
+		settings.TimeBasedDecay       = readByte(settings.TimeBasedDecay ? 1 : 0) != 0;
+		settings.PredictionMode       = static_cast<PredictionModes>(readByte(static_cast<uint8_t>(settings.PredictionMode)));
+		readFloat(settings.PredictionLatency);
+
+		return true;
+	}
+#pragma endregion
+
+
+	// 在内存里拼一个块，满了由调用方取走
+	// 采样记录直接按指针写进预先分配好的缓冲，不逐字节 push_back
+	class BlockEncoder
+	{
+		static constexpr size_t MaxSampleSize = 3 * MaxVarintSize;
+
+		std::vector<uint8_t> _payload;
+		size_t               _size        = 0;
+		uint32_t             _recordCount = 0;
+
+		int64_t _lastTimestamp = 0;
+		int32_t _lastX         = 0;
+		int32_t _lastY         = 0;
+
+		uint8_t* WriteHeader(int64_t timestamp, RecordKinds kind)
+		{
+			if (_size + MaxSampleSize > _payload.size())
+				_payload.resize(_size + MaxSampleSize + MaxPayloadSize / 4);
+
+			auto p = WriteVarint(_payload.data() + _size, ZigZag(timestamp - _lastTimestamp) << 2 | kind);
+
+			_lastTimestamp = timestamp;
+			++_recordCount;
+			return p;
+		}
+
+	public:
+		BlockEncoder() : _payload(MaxPayloadSize + MaxSampleSize)
+		{
+		}
+
+		void AddSample(const GazeSample& sample)
+		{
+			if (!sample.IsValid)
+			{
+				_size = WriteHeader(sample.Timestamp, InvalidSampleRecord) - _payload.data();
+				return;
+			}
+
+			auto p = WriteHeader(sample.Timestamp, SampleRecord);
+
+			auto x = ToFixed(sample.Position.X);
+			auto y = ToFixed(sample.Position.Y);
+
+			p = WriteVarint(p, ZigZag(static_cast<int64_t>(x) - _lastX));
+			p = WriteVarint(p, ZigZag(static_cast<int64_t>(y) - _lastY));
+
+			_size  = p - _payload.data();
+			_lastX = x;
+			_lastY = y;
+		}
+
+		void AddSettings(int64_t timestamp, const TobiiRenderSettings& settings)
+		{
+			_size = WriteHeader(timestamp, SettingsRecord) - _payload.data();
+
+			std::vector<uint8_t> record;
+			GazeRecording::WriteSettings(record, settings);
+
+			_payload.resize(std::max(_payload.size(), _size + record.size()));
+			std::copy(record.begin(), record.end(), _payload.begin() + _size);
+			_size += record.size();
+		}
+
+		bool IsFull() const { return _size >= MaxPayloadSize; }
+		bool IsEmpty() const { return _recordCount == 0; }
+
+		// 把块头和数据追加到 out，之后从空块重新开始
+		void FinishBlock(std::vector<uint8_t>& out)
+		{
+			uint8_t header[BlockHeaderSize];
+			WriteU32(header, BlockMagic);
+			WriteU32(header + 4, static_cast<uint32_t>(_size));
+			WriteU32(header + 8, _recordCount);
+			WriteU32(header + 12, Crc32(_payload.data(), _size));
+
+			out.insert(out.end(), header, header + BlockHeaderSize);
+			out.insert(out.end(), _payload.begin(), _payload.begin() + _size);
+
+			_size          = 0;
+			_recordCount   = 0;
+			_lastTimestamp = 0;
+			_lastX         = 0;
+			_lastY         = 0;
+		}
+	};
+
+	// 解码一个块的数据，onSample(const GazeSample&)，onSettings(int64_t timestamp, const TobiiRenderSettings&)
+	template <typename SampleCallback, typename SettingsCallback>
+	static bool DecodeBlock(const uint8_t* pPayload, size_t size, uint32_t recordCount, SampleCallback&& onSample, SettingsCallback&& onSettings)
+	{
+		auto p    = pPayload;
+		auto pEnd = pPayload + size;
+
+		int64_t timestamp = 0;
+		int64_t x         = 0;
+		int64_t y         = 0;
+
+		for (uint32_t i = 0; i < recordCount; ++i)
+		{
+			uint64_t header;
+			if (!ReadVarint(p, pEnd, header))
+				return false;
+
+			timestamp += UnZigZag(header >> 2);
+
+			switch (header & 0x3)
+			{
+				case SampleRecord:
+				{
+					uint64_t dx, dy;
+					if (!ReadVarint(p, pEnd, dx) || !ReadVarint(p, pEnd, dy))
+						return false;
+
+					x += UnZigZag(dx);
+					y += UnZigZag(dy);
+
+					onSample(GazeSample{timestamp, {FromFixed(x), FromFixed(y)}, true});
+					break;
+				}
+
+				case InvalidSampleRecord:
+					onSample(GazeSample{timestamp, {}, false});
+					break;
+
+				case SettingsRecord:
+				{
+					TobiiRenderSettings settings;
+					if (!ReadSettings(p, pEnd, settings))
+						return false;
+
+					onSettings(timestamp, settings);
+					break;
+				}
+
+				default:
+					return false;
+			}
+		}
+
+		return p == pEnd;
+	}
+
+	// 解码内存里连续的若干块（不含文件头），返回是否全部块都完整
+	template <typename SampleCallback, typename SettingsCallback>
+	static bool DecodeBlocks(const uint8_t* pData, size_t size, SampleCallback&& onSample, SettingsCallback&& onSettings)
+	{
+		auto p    = pData;
+		auto pEnd = pData + size;
+
+		while (p < pEnd)
+		{
+			if (static_cast<size_t>(pEnd - p) < BlockHeaderSize || ReadU32(p) != BlockMagic)
+				return false;
+
+			auto payloadSize = ReadU32(p + 4);
+			auto recordCount = ReadU32(p + 8);
+			auto crc         = ReadU32(p + 12);
+
+			p += BlockHeaderSize;
+
+			if (payloadSize > static_cast<size_t>(pEnd - p) || Crc32(p, payloadSize) != crc)
+				return false;
+
+			if (!DecodeBlock(p, payloadSize, recordCount, onSample, onSettings))
+				return false;
+
+			p += payloadSize;
+		}
+
+		return true;
+	}
+
+
+	// 写文件: 记录先编码进内存里的块，块满了整块顺序追加到文件，析构时写出最后一个不满的块
+	class Recorder
+	{
+		std::ofstream        _file;
+		BlockEncoder         _encoder;
+		std::vector<uint8_t> _block;
+
+		bool WriteBlock()
+		{
+			if (_encoder.IsEmpty())
+				return true;
+
+			_block.clear();
+			_encoder.FinishBlock(_block);
+			_file.write(reinterpret_cast<const char*>(_block.data()), static_cast<std::streamsize>(_block.size()));
+
+			if (!_file)
+			{
+				std::cerr << "Write Gaze Recording Failed" << std::endl;
+				return false;
+			}
+
+			return true;
+		}
+
+	public:
+		Recorder() = default;
+
+		Recorder(const Recorder&)            = delete;
+		Recorder& operator=(const Recorder&) = delete;
+
+		~Recorder()
+		{
+			Close();
+		}
+
+		bool Open(const std::string& path)
+		{
+			_file.open(path, std::ios::binary | std::ios::trunc);
+
+			if (!_file)
+			{
+				std::cerr << "Open Gaze Recording Failed: " << path << std::endl;
+				return false;
+			}
+
+			uint8_t header[FileHeaderSize];
+			WriteU32(header, FileMagic);
+			WriteU32(header + 4, Version);
+			WriteU32(header + 8, CoordinateScale);
+			_file.write(reinterpret_cast<const char*>(header), FileHeaderSize);
+
+			return static_cast<bool>(_file);
+		}
+
+		bool IsOpen() const { return _file.is_open(); }
+
+		bool AddSample(const GazeSample& sample)
+		{
+			_encoder.AddSample(sample);
+			return !_encoder.IsFull() || WriteBlock();
+		}
+
+		bool AddSettings(int64_t timestamp, const TobiiRenderSettings& settings)
+		{
+			_encoder.AddSettings(timestamp, settings);
+			return !_encoder.IsFull() || WriteBlock();
+		}
+
+		// 写出当前不满的块；之后的记录从新块开始
+		bool Flush()
+		{
+			if (!_file.is_open())
+				return false;
+
+			auto isWritten = WriteBlock();
+			_file.flush();
+			return isWritten && static_cast<bool>(_file);
+		}
+
+		void Close()
+		{
+			if (!_file.is_open())
+				return;
+
+			Flush();
+			_file.close();
+		}
+	};
+
+	// 读整个文件并按顺序回调；数据损坏的块报错后跳过，块头损坏时无法定位下一个块，只能停止
+	// 返回是否所有块都完整
+	template <typename SampleCallback, typename SettingsCallback>
+	static bool ReadFile(const std::string& path, SampleCallback&& onSample, SettingsCallback&& onSettings)
+	{
+		std::ifstream file(path, std::ios::binary);
+
+		if (!file)
+		{
+			std::cerr << "Open Gaze Recording Failed: " << path << std::endl;
+			return false;
+		}
+
+		uint8_t header[FileHeaderSize];
+		if (!file.read(reinterpret_cast<char*>(header), FileHeaderSize) || ReadU32(header) != FileMagic || ReadU32(header + 4) != Version || ReadU32(header + 8) != CoordinateScale)
+		{
+			std::cerr << "Invalid Gaze Recording Header: " << path << std::endl;
+			return false;
+		}
+
+		std::vector<uint8_t> block;
+
+		auto isIntact = true;
+
+		while (true)
+		{
+			uint8_t blockHeader[BlockHeaderSize];
+			if (!file.read(reinterpret_cast<char*>(blockHeader), BlockHeaderSize))
+				return isIntact && file.gcount() == 0;
+
+			auto payloadSize = ReadU32(blockHeader + 4);
+
+			if (ReadU32(blockHeader) != BlockMagic || payloadSize > MaxPayloadSize * 2)
+			{
+				std::cerr << "Corrupted Gaze Recording Block Header" << std::endl;
+				return false;
+			}
+
+			block.assign(blockHeader, blockHeader + BlockHeaderSize);
+			block.resize(BlockHeaderSize + payloadSize);
+
+			if (!file.read(reinterpret_cast<char*>(block.data() + BlockHeaderSize), payloadSize))
+			{
+				std::cerr << "Truncated Gaze Recording Block" << std::endl;
+				return false;
+			}
+
+			if (!DecodeBlocks(block.data(), block.size(), onSample, onSettings))
+			{
+				std::cerr << "Corrupted Gaze Recording Block" << std::endl;
+				isIntact = false;
+			}
+		}
+	}
+}
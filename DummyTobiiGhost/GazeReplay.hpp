@@ -0,0 +1,274 @@
+﻿#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Common.h"
+#include "FrameRateController.hpp"
+#include "GazeRecording.hpp"
+#include "SoftRender.hpp"
+
+
+struct ReplayOptions
+{
+	// 回放时的虚拟帧率，与录制时的刷新率无关
+	double FrameRate = 120.0;
+
+	// false: 与 Main.cpp 一样每帧经环形缓冲 ConsumeGazeSamples → Render，结果与实时运行一致
+	// true : 每帧把这一帧的全部采样交给 RenderSamples，热量按采样时长分摊，帧率降到 10 帧左右也不丢采样
+	bool BatchSamples = false;
+
+	// 每隔多少帧调用一次 onFrame，0 表示不输出中间帧
+	uint32_t FrameInterval = 0;
+
+	// BatchSamples 时，一帧内与上一组第一个采样相距不超过这么多像素的连续采样合成一个 splat
+	// 位置取平均，时长相加，热量不变；注视时几十个采样只 splat 一次。0 表示不合并，结果精确
+	float MergeRadius = 0.0f;
+
+	// 非空时由控制器决定每一拍是否渲染以及之后的节拍，FrameRate 只是开始的节拍，与 Main.cpp 的自适应帧率相同
+	FrameRateController* RateController = nullptr;
+};
+
+struct ReplayStats
+{
+	uint64_t TickCount;
+	uint64_t FrameCount;
+	uint64_t RenderedFrameCount;
+	uint64_t SampleCount;
+	uint64_t SettingsCount;
+	int64_t  Duration;    // 记录覆盖的时长，微秒
+	double   WallSeconds; // 回放实际耗时
+};
+
+
+// 按记录里的时间戳驱动 SoftRender，不按 QPC 等待，能跑多快跑多快
+// 帧时间从第一条记录开始按 1 / FrameRate 递增，时间戳早于帧时间的采样属于这一帧
+class GazeReplay
+{
+public:
+	// onFrame(renderer, frameTimestamp)，中间帧需要图像时在回调里 Composite
+	using FrameCallback = std::function<void(SoftRender&, int64_t)>;
+
+private:
+	SoftRender&   _renderer;
+	ReplayOptions _options;
+	FrameCallback _onFrame;
+
+	int64_t _frameInterval  = 0;
+	int64_t _nextFrame      = 0;
+	int64_t _lastFrame      = 0;
+	int64_t _firstTimestamp = 0;
+	bool    _hasStarted     = false;
+
+	std::vector<GazeSample> _batch;
+	Point                   _groupStart = {};
+	uint32_t                _groupCount = 0;
+
+	ReplayStats _stats = {};
+
+	void RunFrame(int64_t timestamp)
+	{
+		++_stats.FrameCount;
+
+		auto frameDuration = static_cast<double>(timestamp - _lastFrame) * 1e-6;
+		_lastFrame         = timestamp;
+
+		if (_options.BatchSamples)
+		{
+			_renderer.AdvanceFrame(timestamp);
+
+			if (_renderer.RenderSamples(_batch.data(), _batch.size(), timestamp, frameDuration))
+				++_stats.RenderedFrameCount;
+
+			_batch.clear();
+		}
+		else
+		{
+			_renderer.ConsumeGazeSamples(timestamp);
+			_renderer.AdvanceFrame(timestamp);
+
+			if (!_renderer.IsIdle() && _renderer.Render())
+				++_stats.RenderedFrameCount;
+		}
+
+		if (_onFrame && _options.FrameInterval != 0 && _stats.FrameCount % _options.FrameInterval == 0)
+			_onFrame(_renderer, timestamp);
+	}
+
+	// 控制器决定这一拍是否渲染，渲染后按场的活跃程度和注视速度调整节拍
+	void Tick(int64_t timestamp)
+	{
+		++_stats.TickCount;
+
+		auto pController = _options.RateController;
+
+		if (pController == nullptr)
+		{
+			RunFrame(timestamp);
+			return;
+		}
+
+		GazeSample latest    = {};
+		auto       hasLatest = false;
+
+		if (_options.BatchSamples)
+		{
+			hasLatest = !_batch.empty();
+			if (hasLatest)
+				latest = _batch.back();
+		}
+		else
+		{
+			hasLatest = _renderer.DrainGazeSamples(latest);
+		}
+
+		if (!pController->IsFrameDue(timestamp, hasLatest ? &latest : nullptr))
+			return;
+
+		RunFrame(timestamp);
+
+		const auto& data = _renderer.GetRenderData();
+		pController->Update({timestamp, data.HasGaze(), data.HasGaze() ? data.CurrentGaze() : Point{}, _renderer.TakeFieldActivity(), _renderer.IsIdle()});
+		_frameInterval = std::max<int64_t>(static_cast<int64_t>(1e6 / pController->GetTickRate()), 1);
+	}
+
+	// RenderSamples 按与上一个采样的时间差分摊热量，合并后的采样取组内最后一个时间戳，时长自然就是整组的时长
+	void BatchSample(const GazeSample& sample)
+	{
+		if (_options.MergeRadius > 0.0f && sample.IsValid && !_batch.empty() && _batch.back().IsValid)
+		{
+			auto dx = sample.Position.X - _groupStart.X;
+			auto dy = sample.Position.Y - _groupStart.Y;
+
+			if (dx * dx + dy * dy <= _options.MergeRadius * _options.MergeRadius)
+			{
+				auto& merged = _batch.back();
+
+				++_groupCount;
+				merged.Timestamp  = sample.Timestamp;
+				merged.Position.X += (sample.Position.X - merged.Position.X) / static_cast<float>(_groupCount);
+				merged.Position.Y += (sample.Position.Y - merged.Position.Y) / static_cast<float>(_groupCount);
+				return;
+			}
+		}
+
+		_batch.push_back(sample);
+		_groupStart = sample.Position;
+		_groupCount = 1;
+	}
+
+	// 把帧推进到 timestamp 之后的第一帧之前
+	void AdvanceTo(int64_t timestamp)
+	{
+		if (!_hasStarted)
+		{
+			_hasStarted     = true;
+			_firstTimestamp = timestamp;
+			_lastFrame      = timestamp;
+			_nextFrame      = timestamp + _frameInterval;
+			return;
+		}
+
+		while (timestamp >= _nextFrame)
+		{
+			Tick(_nextFrame);
+			_nextFrame += _frameInterval;
+		}
+	}
+
+public:
+	GazeReplay(SoftRender& renderer, const ReplayOptions& options = {}, FrameCallback onFrame = nullptr) : _renderer(renderer),
+	                                                                                                     _options(options),
+	                                                                                                     _onFrame(std::move(onFrame))
+	{
+		_frameInterval = std::max<int64_t>(static_cast<int64_t>(1e6 / options.FrameRate), 1);
+	}
+
+	void AddSample(const GazeSample& sample)
+	{
+		AdvanceTo(sample.Timestamp);
+		++_stats.SampleCount;
+
+		if (_options.BatchSamples)
+		{
+			BatchSample(sample);
+			return;
+		}
+
+		// 每帧都会取空，只有一帧内超过容量的采样才会丢
+		_renderer.GetGazeRing().TryPush(sample);
+	}
+
+	// 没有采样的一段时间也按节拍推进到 timestamp，用于记录结尾的空白
+	void AdvanceTime(int64_t timestamp)
+	{
+		AdvanceTo(timestamp);
+	}
+
+	void AddSettings(int64_t timestamp, const TobiiRenderSettings& settings)
+	{
+		AdvanceTo(timestamp);
+		++_stats.SettingsCount;
+
+		_renderer.UpdateSettings(settings);
+	}
+
+	// 渲染最后一帧，之后 GetField 就是整段记录的热力场
+	void Finish()
+	{
+		if (!_hasStarted)
+			return;
+
+		RunFrame(_nextFrame);
+		_renderer.Resolve();
+
+		_stats.Duration = _nextFrame - _firstTimestamp;
+	}
+
+	// 回放整个记录文件，返回记录是否完整
+	bool ReplayFile(const std::string& path)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		auto isIntact = GazeRecording::ReadFile(path, [this](const GazeSample& sample) { AddSample(sample); }, [this](int64_t timestamp, const TobiiRenderSettings& settings)
+		{
+			AddSettings(timestamp, settings);
+		});
+
+		Finish();
+
+		_stats.WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return isIntact;
+	}
+
+	const ReplayStats& GetStats() const { return _stats; }
+};
+
+
+// 把 Composite 的预乘 alpha R8G8B8A8（小端下内存里依次是 R G B A）写成 PAM（带 alpha 的 PNM），大多数图像工具都能直接打开
+static bool WritePam(const std::string& path, const uint32_t* pPixels, uint32_t width, uint32_t height)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+	if (!file)
+	{
+		std::cerr << "Open Image Failed: " << path << std::endl;
+		return false;
+	}
+
+	file << "P7\nWIDTH " << width << "\nHEIGHT " << height << "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+	file.write(reinterpret_cast<const char*>(pPixels), static_cast<std::streamsize>(width) * height * sizeof(uint32_t));
+
+	if (!file.flush())
+	{
+		std::cerr << "Write Image Failed: " << path << std::endl;
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,521 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include "Common.h"
+#include "GazeRecording.hpp"
+#include "SpscRing.hpp"
+#include "Telemetry.hpp"
+
+
+// 采样线程的统计，时间单位为微秒
+struct GazeSourceStats
+{
+	uint64_t SampleCount;
+	uint64_t DroppedCount; // 环形缓冲满了没放进去的
+	uint64_t LostCount;    // 源自己发现的缺口，例如 UDP 包序号不连续
+
+	double  MeanInterval; // 相邻两次推入的间隔
+	double  Jitter;       // 间隔的标准差
+	int64_t MaxInterval;
+
+	double  MeanLateness; // 推入时刻比采样时间戳晚多少，定时的源上就是调度误差
+	int64_t MaxLateness;
+};
+
+
+// 注视采样源: 各自的线程按自己的采样率产生采样，推进渲染器的 GazeRing，渲染卡顿不影响采样
+// 子类实现 NextSample，阻塞到下一个采样；析构前必须 Stop（子类析构函数里调用），线程还在调用子类的虚函数
+// 时间戳用 steady_clock 的微秒数；MSVC 的 steady_clock 就是 QPC，与 Main.cpp 里 QpcToMicroseconds 的帧时间一致
+class GazeSource
+{
+public:
+	// 在采样线程上调用，例如写记录文件
+	using SampleListener = std::function<void(const GazeSample&)>;
+
+private:
+	std::thread       _thread;
+	std::atomic<bool> _isRunning{false};
+	std::atomic<bool> _isFinished{false};
+
+	GazeRing*      _pRing = nullptr;
+	SampleListener _listener;
+
+	// 只有采样线程写，GetStats 在其他线程读，不需要读改写
+	std::atomic<uint64_t> _sampleCount{0};
+	std::atomic<uint64_t> _droppedCount{0};
+	std::atomic<uint64_t> _lostCount{0};
+	std::atomic<double>   _intervalSum{0.0};
+	std::atomic<double>   _intervalSquareSum{0.0};
+	std::atomic<int64_t>  _maxInterval{0};
+	std::atomic<double>   _latenessSum{0.0};
+	std::atomic<int64_t>  _maxLateness{0};
+
+	int64_t _lastPush = 0;
+
+	void ResetStats()
+	{
+		_sampleCount       = 0;
+		_droppedCount      = 0;
+		_lostCount         = 0;
+		_intervalSum       = 0.0;
+		_intervalSquareSum = 0.0;
+		_maxInterval       = 0;
+		_latenessSum       = 0.0;
+		_maxLateness       = 0;
+
+		_lastPush = 0;
+	}
+
+	void Push(const GazeSample& sample)
+	{
+		StageTimer timer(TelemetryStages::GazePush);
+
+		auto now = Now();
+
+		if (!_pRing->TryPush(sample))
+			_droppedCount.store(_droppedCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+		if (_lastPush != 0)
+		{
+			auto interval = static_cast<double>(now - _lastPush);
+
+			_intervalSum.store(_intervalSum.load(std::memory_order_relaxed) + interval, std::memory_order_relaxed);
+			_intervalSquareSum.store(_intervalSquareSum.load(std::memory_order_relaxed) + interval * interval, std::memory_order_relaxed);
+			_maxInterval.store(std::max(_maxInterval.load(std::memory_order_relaxed), now - _lastPush), std::memory_order_relaxed);
+		}
+
+		auto lateness = std::max<int64_t>(now - sample.Timestamp, 0);
+
+		_latenessSum.store(_latenessSum.load(std::memory_order_relaxed) + static_cast<double>(lateness), std::memory_order_relaxed);
+		_maxLateness.store(std::max(_maxLateness.load(std::memory_order_relaxed), lateness), std::memory_order_relaxed);
+
+		_lastPush = now;
+		_sampleCount.store(_sampleCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+		if (_listener)
+			_listener(sample);
+	}
+
+	void Run()
+	{
+		GazeSample sample;
+
+		while (_isRunning.load(std::memory_order_relaxed) && NextSample(sample))
+			Push(sample);
+
+		_isFinished = true;
+	}
+
+protected:
+	// 采样线程上调用，阻塞到下一个采样；返回 false 表示源已经结束或 IsRunning() 变成 false
+	virtual bool NextSample(GazeSample& sample) = 0;
+
+	// Start 时在调用线程上执行，失败时不启动线程
+	virtual bool OpenSource() { return true; }
+
+	// Stop 时线程结束之后执行
+	virtual void CloseSource() {}
+
+	bool IsRunning() const { return _isRunning.load(std::memory_order_relaxed); }
+
+	void CountLost(uint64_t count) { _lostCount.store(_lostCount.load(std::memory_order_relaxed) + count, std::memory_order_relaxed); }
+
+	// 睡到 timestamp（微秒），分段睡以便 Stop 时及时退出；返回 IsRunning()
+	bool WaitUntil(int64_t timestamp)
+	{
+		constexpr int64_t MaxSleep = 50000;
+
+		for (auto now = Now(); now < timestamp && IsRunning(); now = Now())
+			std::this_thread::sleep_for(std::chrono::microseconds(std::min(timestamp - now, MaxSleep)));
+
+		return IsRunning();
+	}
+
+public:
+	GazeSource() = default;
+
+	GazeSource(const GazeSource&)            = delete;
+	GazeSource& operator=(const GazeSource&) = delete;
+
+	virtual ~GazeSource() = default;
+
+	static int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// 在 Start 之前设置
+	void SetListener(SampleListener listener) { _listener = std::move(listener); }
+
+	bool Start(GazeRing& ring)
+	{
+		if (_thread.joinable())
+			return false;
+
+		if (!OpenSource())
+			return false;
+
+		ResetStats();
+
+		_pRing      = &ring;
+		_isFinished = false;
+		_isRunning  = true;
+		_thread     = std::thread([this] { Run(); });
+		return true;
+	}
+
+	void Stop()
+	{
+		if (!_thread.joinable())
+			return;
+
+		_isRunning = false;
+		_thread.join();
+
+		CloseSource();
+	}
+
+	// 源已经没有更多采样，例如回放到了文件末尾
+	bool IsFinished() const { return _isFinished.load(std::memory_order_relaxed); }
+
+	GazeSourceStats GetStats() const
+	{
+		GazeSourceStats stats = {};
+
+		stats.SampleCount  = _sampleCount.load(std::memory_order_acquire);
+		stats.DroppedCount = _droppedCount.load(std::memory_order_relaxed);
+		stats.LostCount    = _lostCount.load(std::memory_order_relaxed);
+		stats.MaxInterval  = _maxInterval.load(std::memory_order_relaxed);
+		stats.MaxLateness  = _maxLateness.load(std::memory_order_relaxed);
+
+		if (stats.SampleCount > 1)
+		{
+			auto intervals = static_cast<double>(stats.SampleCount - 1);
+
+			stats.MeanInterval = _intervalSum.load(std::memory_order_relaxed) / intervals;
+			stats.Jitter       = std::sqrt(std::max(_intervalSquareSum.load(std::memory_order_relaxed) / intervals - stats.MeanInterval * stats.MeanInterval, 0.0));
+		}
+
+		if (stats.SampleCount > 0)
+			stats.MeanLateness = _latenessSum.load(std::memory_order_relaxed) / static_cast<double>(stats.SampleCount);
+
+		return stats;
+	}
+
+	static void PrintStats(std::ostream& out, const char* name, const GazeSourceStats& stats)
+	{
+		out << name << ": " << stats.SampleCount << " samples, " << stats.DroppedCount << " dropped, " << stats.LostCount << " lost, interval "
+			<< stats.MeanInterval / 1000.0 << " ms (jitter " << stats.Jitter / 1000.0 << " ms, max " << stats.MaxInterval / 1000.0 << " ms), late "
+			<< stats.MeanLateness / 1000.0 << " ms (max " << stats.MaxLateness / 1000.0 << " ms)" << std::endl;
+	}
+};
+
+
+// 按固定频率轮询鼠标，位置变化且在窗口内时产生一个采样，与原来每帧轮询一次的规则相同
+// poll(Point&) 在采样线程上调用，返回 false 表示不在窗口内
+class MouseGazeSource : public GazeSource
+{
+public:
+	using Poll = std::function<bool(Point&)>;
+
+private:
+	Poll    _poll;
+	int64_t _interval;
+	int64_t _nextPoll  = 0;
+	Point   _lastPoint = {-1.0f, -1.0f};
+
+protected:
+	bool OpenSource() override
+	{
+		_nextPoll  = Now();
+		_lastPoint = {-1.0f, -1.0f};
+		return true;
+	}
+
+	bool NextSample(GazeSample& sample) override
+	{
+		while (WaitUntil(_nextPoll))
+		{
+			auto timestamp = Now();
+
+			// 落后太多时不追赶，从现在重新开始
+			_nextPoll = std::max(_nextPoll + _interval, timestamp);
+
+			Point point;
+			if (!_poll(point) || (point.X == _lastPoint.X && point.Y == _lastPoint.Y))
+				continue;
+
+			_lastPoint = point;
+			sample     = {timestamp, point, true};
+			return true;
+		}
+
+		return false;
+	}
+
+public:
+	MouseGazeSource(Poll poll, double pollRate = 1000.0) : _poll(std::move(poll)),
+	                                                       _interval(std::max<int64_t>(static_cast<int64_t>(1e6 / pollRate), 1))
+	{
+	}
+
+	~MouseGazeSource() override { Stop(); }
+};
+
+
+// 按固定采样率调用 generator(timestamp) 生成采样，用于没有眼动仪时的测试
+class SyntheticGazeSource : public GazeSource
+{
+public:
+	using Generator = std::function<GazeSample(int64_t)>;
+
+private:
+	Generator _generator;
+	int64_t   _interval;
+	int64_t   _next = 0;
+
+protected:
+	bool OpenSource() override
+	{
+		_next = Now();
+		return true;
+	}
+
+	bool NextSample(GazeSample& sample) override
+	{
+		if (!WaitUntil(_next))
+			return false;
+
+		sample = _generator(_next);
+		_next += _interval;
+		return true;
+	}
+
+public:
+	SyntheticGazeSource(Generator generator, double sampleRate) : _generator(std::move(generator)),
+	                                                              _interval(std::max<int64_t>(static_cast<int64_t>(1e6 / sampleRate), 1))
+	{
+	}
+
+	~SyntheticGazeSource() override { Stop(); }
+};
+
+
+// 按原来的时间间隔实时回放一段采样，时间戳平移到开始回放的时刻
+class TraceGazeSource : public GazeSource
+{
+	std::vector<GazeSample> _samples;
+	bool                    _isLooping;
+
+	size_t  _index  = 0;
+	int64_t _offset = 0;
+
+protected:
+	bool OpenSource() override
+	{
+		if (_samples.empty())
+			return false;
+
+		_index  = 0;
+		_offset = Now() - _samples.front().Timestamp;
+		return true;
+	}
+
+	bool NextSample(GazeSample& sample) override
+	{
+		if (_index == _samples.size())
+		{
+			if (!_isLooping)
+				return false;
+
+			// 下一轮接在上一轮末尾之后一个采样间隔
+			auto span = _samples.back().Timestamp - _samples.front().Timestamp;
+			auto step = _samples.size() > 1 ? span / static_cast<int64_t>(_samples.size() - 1) : 1;
+
+			_offset += span + step;
+			_index = 0;
+		}
+
+		sample = _samples[_index++];
+		sample.Timestamp += _offset;
+
+		return WaitUntil(sample.Timestamp);
+	}
+
+public:
+	explicit TraceGazeSource(std::vector<GazeSample> samples, bool isLooping = false) : _samples(std::move(samples)),
+	                                                                                   _isLooping(isLooping)
+	{
+	}
+
+	~TraceGazeSource() override { Stop(); }
+
+	// 读出记录文件里的全部采样，设置忽略
+	static bool LoadRecording(const std::string& path, std::vector<GazeSample>& samples)
+	{
+		return GazeRecording::ReadFile(path, [&](const GazeSample& sample) { samples.push_back(sample); }, [](int64_t, const TobiiRenderSettings&) {});
+	}
+};
+
+
+// 本机 UDP 端口上的眼动仪替身: 其他进程每个采样发一个 GazePacket，到达时刻作为时间戳
+// 包序号不连续时计入 LostCount
+class SocketGazeSource : public GazeSource
+{
+public:
+#pragma pack(push, 1)
+	struct GazePacket
+	{
+		uint32_t Sequence;
+		float    X;
+		float    Y;
+		uint32_t IsValid;
+	};
+#pragma pack(pop)
+
+#if defined(_WIN32)
+	using SocketHandle = SOCKET;
+	static constexpr SocketHandle InvalidSocket = INVALID_SOCKET;
+#else
+	using SocketHandle = int;
+	static constexpr SocketHandle InvalidSocket = -1;
+#endif
+
+private:
+	uint16_t     _port;
+	SocketHandle _socket = InvalidSocket;
+
+	uint32_t _nextSequence = 0;
+	bool     _hasSequence  = false;
+
+	// 接收超时，Stop 最多等这么久
+	static constexpr int ReceiveTimeoutMs = 100;
+
+	static void CloseSocket(SocketHandle socket)
+	{
+#if defined(_WIN32)
+		closesocket(socket);
+#else
+		close(socket);
+#endif
+	}
+
+protected:
+	bool OpenSource() override
+	{
+#if defined(_WIN32)
+		WSADATA wsaData;
+		if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+		{
+			std::cerr << "WSAStartup Failed" << std::endl;
+			return false;
+		}
+#endif
+
+		_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+		if (_socket == InvalidSocket)
+		{
+			std::cerr << "Create Gaze Socket Failed" << std::endl;
+			CloseSource();
+			return false;
+		}
+
+#if defined(_WIN32)
+		DWORD timeout = ReceiveTimeoutMs;
+#else
+		timeval timeout = {0, ReceiveTimeoutMs * 1000};
+#endif
+		setsockopt(_socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+
+		sockaddr_in address     = {};
+		address.sin_family      = AF_INET;
+		address.sin_port        = htons(_port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		if (bind(_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+		{
+			std::cerr << "Bind Gaze Socket Failed: " << _port << std::endl;
+			CloseSource();
+			return false;
+		}
+
+		_hasSequence = false;
+		return true;
+	}
+
+	void CloseSource() override
+	{
+		if (_socket != InvalidSocket)
+		{
+			CloseSocket(_socket);
+			_socket = InvalidSocket;
+		}
+
+#if defined(_WIN32)
+		WSACleanup();
+#endif
+	}
+
+	bool NextSample(GazeSample& sample) override
+	{
+		GazePacket packet;
+
+		while (IsRunning())
+		{
+			// 超时或出错都返回负数，回到循环检查 IsRunning
+			auto size = recv(_socket, reinterpret_cast<char*>(&packet), sizeof(packet), 0);
+
+			if (size != static_cast<decltype(size)>(sizeof(packet)))
+				continue;
+
+			// 序号回退的是乱序到达的旧包，不算丢失，也不把期望的序号拉回去
+			auto ahead = packet.Sequence - _nextSequence;
+
+			if (!_hasSequence || ahead < 0x80000000u)
+			{
+				if (_hasSequence && ahead != 0)
+					CountLost(ahead);
+
+				_nextSequence = packet.Sequence + 1;
+				_hasSequence  = true;
+			}
+
+			sample = {Now(), {packet.X, packet.Y}, packet.IsValid != 0};
+			return true;
+		}
+
+		return false;
+	}
+
+public:
+	explicit SocketGazeSource(uint16_t port) : _port(port)
+	{
+	}
+
+	~SocketGazeSource() override { Stop(); }
+
+	uint16_t GetPort() const { return _port; }
+};
@@ -0,0 +1,155 @@
+﻿#pragma once
+
+#include <d3d11.h>
+#include <iostream>
+
+#include "Utils.hpp"
+
+
+// 用 D3D11 时间戳查询测一段 GPU 命令的耗时，结果晚几帧才能拿到，所以轮换使用多组查询，读取时不阻塞
+// Begin 和 End 之间可以用 Mark 再打几个时间戳，把这一段分成几个阶段
+class GpuTimer
+{
+public:
+	static constexpr UINT MaxTimestamps = 4;
+
+private:
+	static constexpr UINT FrameCount = 4;
+
+	struct QuerySet
+	{
+		ID3D11Query* pDisjoint;
+		ID3D11Query* pTimestamps[MaxTimestamps];
+		UINT         TimestampCount;
+		bool         IsPending;
+
+		void Release()
+		{
+			Utils::SafeRelease(pDisjoint);
+
+			for (auto& pTimestamp : pTimestamps)
+				Utils::SafeRelease(pTimestamp);
+
+			TimestampCount = 0;
+			IsPending      = false;
+		}
+	};
+
+	QuerySet _querySets[FrameCount] = {};
+	UINT     _writeIndex            = 0;
+	UINT     _readIndex             = 0;
+
+public:
+	~GpuTimer() { Release(); }
+
+	bool Init(ID3D11Device* pDevice)
+	{
+		D3D11_QUERY_DESC disjointDesc  = {D3D11_QUERY_TIMESTAMP_DISJOINT, 0};
+		D3D11_QUERY_DESC timestampDesc = {D3D11_QUERY_TIMESTAMP, 0};
+
+		for (auto& querySet : _querySets)
+		{
+			auto isCreated = SUCCEEDED(pDevice->CreateQuery(&disjointDesc, &querySet.pDisjoint));
+
+			for (UINT i = 0; i < MaxTimestamps && isCreated; ++i)
+				isCreated = SUCCEEDED(pDevice->CreateQuery(&timestampDesc, &querySet.pTimestamps[i]));
+
+			if (!isCreated)
+			{
+				std::cerr << "Create Timestamp Query Failed" << std::endl;
+				Release();
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void Release()
+	{
+		for (auto& querySet : _querySets)
+			querySet.Release();
+
+		_writeIndex = _readIndex = 0;
+	}
+
+	bool IsValid() const { return _querySets[0].pDisjoint != nullptr; }
+
+	// 所有查询都还没读回时跳过这一帧，不覆盖未完成的查询
+	bool Begin(ID3D11DeviceContext* pContext)
+	{
+		auto& querySet = _querySets[_writeIndex];
+
+		if (!IsValid() || querySet.IsPending)
+			return false;
+
+		pContext->Begin(querySet.pDisjoint);
+		pContext->End(querySet.pTimestamps[0]);
+
+		querySet.TimestampCount = 1;
+		return true;
+	}
+
+	// 结束上一个阶段、开始下一个阶段；只在 Begin 返回 true 之后调用，超过 MaxTimestamps - 1 段的忽略
+	void Mark(ID3D11DeviceContext* pContext)
+	{
+		auto& querySet = _querySets[_writeIndex];
+
+		if (querySet.TimestampCount < MaxTimestamps - 1)
+			pContext->End(querySet.pTimestamps[querySet.TimestampCount++]);
+	}
+
+	void End(ID3D11DeviceContext* pContext)
+	{
+		auto& querySet = _querySets[_writeIndex];
+
+		pContext->End(querySet.pTimestamps[querySet.TimestampCount++]);
+		pContext->End(querySet.pDisjoint);
+
+		querySet.IsPending = true;
+		_writeIndex        = (_writeIndex + 1) % FrameCount;
+	}
+
+	// 取最早一组已完成的结果（秒），GPU 还没执行完或时钟不连续时返回 false
+	// pStages 非空时按 Mark 分段写入各段的秒数（至少 MaxTimestamps - 1 个），stageCount 为段数
+	bool TryResolve(ID3D11DeviceContext* pContext, double& seconds, double* pStages = nullptr, UINT* pStageCount = nullptr)
+	{
+		auto& querySet = _querySets[_readIndex];
+
+		if (!querySet.IsPending)
+			return false;
+
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+		UINT64                              timestamps[MaxTimestamps];
+
+		if (pContext->GetData(querySet.pDisjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			return false;
+
+		for (UINT i = 0; i < querySet.TimestampCount; ++i)
+		{
+			if (pContext->GetData(querySet.pTimestamps[i], &timestamps[i], sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+				return false;
+		}
+
+		querySet.IsPending = false;
+		_readIndex         = (_readIndex + 1) % FrameCount;
+
+		if (disjoint.Disjoint || disjoint.Frequency == 0)
+			return false;
+
+		auto frequency = static_cast<double>(disjoint.Frequency);
+		auto lastIndex = querySet.TimestampCount - 1;
+
+		seconds = static_cast<double>(timestamps[lastIndex] - timestamps[0]) / frequency;
+
+		if (pStages != nullptr && pStageCount != nullptr)
+		{
+			*pStageCount = lastIndex;
+
+			for (UINT i = 0; i < lastIndex; ++i)
+				pStages[i] = static_cast<double>(timestamps[i + 1] - timestamps[i]) / frequency;
+		}
+
+		return true;
+	}
+};
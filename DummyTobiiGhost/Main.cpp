@@ -1,9 +1,20 @@
-﻿#include <d3d11.h>
+﻿#include <winsock2.h> // 必须在 windows.h 之前，否则 windows.h 会带进旧的 winsock.h，与 GazeSource.hpp 冲突
+#include <d3d11.h>
 #include <windows.h>
+#include <timeapi.h>
 #include <windowsx.h>
 #include <iostream>
 #include <dwmapi.h>
 
+#include "Benchmark.hpp"
+#include "FramePacer.hpp"
+#include "FrameRateController.hpp"
+#include "GazeGenerator.hpp"
+#include "GazeRecording.hpp"
+#include "GazeReplay.hpp"
+#include "GazeSource.hpp"
+#include "SelfTest.hpp"
+#include "Telemetry.hpp"
 #include "TobiiRender.hpp"
 
 
@@ -11,10 +22,6 @@ static auto  _swapChainOccluded = false;
 static UINT  _resizeWidth       = 0,    _resizeHeight = 0;
 static UINT  _width             = 1200, _height       = 600;
 static auto  _frameRate         = 120;
-static auto  _frameDuration     = 1.0 / _frameRate;
-static POINT _mousePos          = {0, 0};
-
-static POINT _lastMousePos = {0, 0};
 
 LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
@@ -110,24 +117,119 @@ void Blur(HWND hwnd)
 }
 
 
-void UpdateMousePositionInWindow(HWND hwnd)
+// 在采样线程上调用: 鼠标的窗口坐标，不在窗口内时返回 false
+bool GetMousePositionInWindow(HWND hwnd, Point& position)
 {
 	POINT point;
-	if (GetCursorPos(&point))
+	RECT  clientRect;
+
+	// 将屏幕坐标转换为窗口坐标
+	if (!GetCursorPos(&point) || !ScreenToClient(hwnd, &point) || !GetClientRect(hwnd, &clientRect))
+		return false;
+
+	if (point.x < 0 || point.x > clientRect.right || point.y < 0 || point.y > clientRect.bottom)
+		return false;
+
+	position = {point.x * 1.0f, point.y * 1.0f};
+	return true;
+}
+
+
+// 命令行里 name 后面的参数，没有时返回 nullptr
+const char* FindArgument(int argc, char* argv[], const char* name)
+{
+	for (auto i = 1; i + 1 < argc; ++i)
 	{
-		// 将屏幕坐标转换为窗口坐标
-		if (ScreenToClient(hwnd, &point))
-		{
-			_mousePos = point;
-		}
+		if (strcmp(argv[i], name) == 0)
+			return argv[i + 1];
+	}
+
+	return nullptr;
+}
+
+bool HasArgument(int argc, char* argv[], const char* name)
+{
+	for (auto i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], name) == 0)
+			return true;
 	}
+
+	return false;
 }
 
 
-int main()
+int main(int argc, char* argv[])
 {
 	SetConsoleOutputCP(CP_UTF8);
 
+	// 无窗口跑一遍软件内核的性能测试
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+	{
+		Benchmark::RunAll(std::cout);
+		return 0;
+	}
+
+	// 无窗口检查软件内核与 Shader 参考实现是否一致、脏矩形是否覆盖所有变化的像素，有失败时返回 1
+	if (argc > 1 && strcmp(argv[1], "--selftest") == 0)
+		return SelfTest::RunAll(std::cout) ? 0 : 1;
+
+	// --replay <记录> <宽> <高> [输出.pam] [--power <策略>]: 不开窗口，按记录的时间戳尽快回放，输出最终的热力图
+	// 带 --power 时按自适应帧率回放，离线检查策略在这段记录上渲染了多少帧
+	if (argc > 4 && strcmp(argv[1], "--replay") == 0)
+	{
+		auto width  = static_cast<uint32_t>(atoi(argv[3]));
+		auto height = static_cast<uint32_t>(atoi(argv[4]));
+
+		SoftRender render(width, height);
+
+		// 每帧一次性处理这一帧的全部采样，10 帧/秒就不会丢热量；16 像素远小于热力图半径，合并后看不出差别
+		ReplayOptions options = {};
+		options.FrameRate     = 10.0;
+		options.BatchSamples  = true;
+		options.MergeRadius   = 16.0f;
+
+		PowerPolicies       policy = PowerPolicies::Balanced;
+		FrameRateController rateController;
+
+		if (auto pPolicy = FindArgument(argc, argv, "--power"))
+		{
+			if (!FrameRateController::ParsePolicy(pPolicy, policy))
+			{
+				std::cerr << "Unknown Power Policy: " << pPolicy << std::endl;
+				return 1;
+			}
+
+			rateController.SetParams(FrameRateParams::FromPolicy(policy));
+			options.RateController = &rateController;
+		}
+
+		GazeReplay replay(render, options);
+		auto       isIntact = replay.ReplayFile(argv[2]);
+
+		const auto& stats = replay.GetStats();
+		std::cout << stats.SampleCount << " samples, " << stats.Duration / 1e6 << " s recorded, replayed in " << stats.WallSeconds << " s" << std::endl;
+
+		if (options.RateController != nullptr)
+			FrameRateController::PrintStats(std::cout, rateController.GetStats());
+
+		if (argc > 5 && argv[5][0] != '-')
+		{
+			std::vector<uint32_t> image(static_cast<size_t>(width) * height);
+			render.Invalidate();
+			render.Composite(image.data(), width);
+			WritePam(argv[5], image.data(), width, height);
+		}
+
+		return isIntact ? 0 : 1;
+	}
+
+	// --record <path>: 把喂给叠加层的注视采样和设置写进记录文件
+	GazeRecording::Recorder recorder;
+
+	if (auto pPath = FindArgument(argc, argv, "--record"); pPath != nullptr && !recorder.Open(pPath))
+		return 1;
+
 	constexpr wchar_t CLASS_NAME[] = L"Sample_Window_Class";
 
 	WNDCLASSW wc     = {};
@@ -179,18 +281,98 @@ int main()
 	settings.Size = 0.8f;
 	settings.Color = { 0.0f, 0.0f, 0.0f, 0.8f };
 	settings.BackgroundColor = { 1.0f, 1.0f, 1.0f, 0.3f };
+	settings.TimeBasedDecay = true;
 
 	tobiiRender.UpdateSettings(settings);
 
-	LARGE_INTEGER frequency;
-	QueryPerformanceFrequency(&frequency);
+	// 和游戏同时运行时，GPU 每帧超过 1.5ms 就降低热力场分辨率
+	tobiiRender.SetFrameBudget(0.0015);
+
+	// 先睡眠再忙等最后一小段，帧间隔准确而不占满一个核；时间戳与注视采样同一时钟
+	SteadyPacerClock pacerClock;
+	FramePacer<>     pacer(pacerClock, _frameRate);
 
-	LARGE_INTEGER lastTime;
-	QueryPerformanceCounter(&lastTime);
+	// 默认按注视速度和场的变化在 10 ~ 240 帧之间自适应，空闲时停止渲染；--power performance/balanced/saver 选择策略，--fixed-rate 固定 120 帧
+	auto                isAdaptive = !HasArgument(argc, argv, "--fixed-rate");
+	PowerPolicies       policy     = PowerPolicies::Balanced;
+	FrameRateController rateController;
+
+	if (auto pPolicy = FindArgument(argc, argv, "--power"); pPolicy != nullptr && !FrameRateController::ParsePolicy(pPolicy, policy))
+		std::cerr << "Unknown Power Policy: " << pPolicy << std::endl;
+
+	rateController.SetParams(FrameRateParams::FromPolicy(policy));
+
+	// 各阶段耗时一直在记录，退出时输出；--telemetry 时运行中每 5 秒输出一次快照
+	auto    isTelemetryPrinting = HasArgument(argc, argv, "--telemetry");
+	int64_t nextTelemetry       = 0;
+
+	if (recorder.IsOpen())
+		recorder.AddSettings(pacerClock.Now(), settings);
+
+	// 注视采样在自己的线程上按源的采样率产生，渲染卡顿不影响采样:
+	// 默认 1 kHz 轮询鼠标；--gaze-socket <端口> 本机 UDP 眼动仪替身；--gaze-file <记录> 循环回放；--gaze-synthetic 合成轨迹
+	std::unique_ptr<GazeSource> gazeSource;
+
+	if (auto pPort = FindArgument(argc, argv, "--gaze-socket"))
+	{
+		gazeSource = std::make_unique<SocketGazeSource>(static_cast<uint16_t>(atoi(pPort)));
+	}
+	else if (auto pPath = FindArgument(argc, argv, "--gaze-file"))
+	{
+		std::vector<GazeSample> samples;
+		if (!TraceGazeSource::LoadRecording(pPath, samples) && samples.empty())
+			return 1;
+
+		gazeSource = std::make_unique<TraceGazeSource>(std::move(samples), true);
+	}
+	else if (HasArgument(argc, argv, "--gaze-synthetic"))
+	{
+		// 按启动时的窗口大小生成 1200 Hz 的注视、扫视、眨眼和跟踪丢失，Seed 固定，每次运行的眼动相同
+		RECT clientRect;
+		GetClientRect(hwnd, &clientRect);
+
+		GazeGeneratorParams params = {};
+		params.Width               = static_cast<float>(clientRect.right);
+		params.Height              = static_cast<float>(clientRect.bottom);
+
+		gazeSource = std::make_unique<SyntheticGazeSource>([generator = GazeGenerator(params)](int64_t timestamp) mutable
+		{
+			auto sample      = generator.Next();
+			sample.Timestamp = timestamp;
+			return sample;
+		}, params.SampleRate);
+	}
+	else
+	{
+		gazeSource = std::make_unique<MouseGazeSource>([hwnd](Point& position) { return GetMousePositionInWindow(hwnd, position); }, 1000.0);
+	}
+
+	// 记录文件只在采样线程上写
+	if (recorder.IsOpen())
+		gazeSource->SetListener([&recorder](const GazeSample& sample) { recorder.AddSample(sample); });
+
+	// 只有采样线程的 1 ms 睡眠需要把系统计时器精度调到 1 ms，帧节拍用高精度可等待计时器，不依赖它
+	timeBeginPeriod(1);
+
+	if (!gazeSource->Start(tobiiRender.GetGazeRing()))
+	{
+		timeEndPeriod(1);
+		return 1;
+	}
 
 	auto done = false;
 	while (!done)
 	{
+		auto timestamp = pacer.WaitForNextFrame();
+
+		if (isTelemetryPrinting && timestamp >= nextTelemetry)
+		{
+			if (nextTelemetry != 0)
+				Telemetry::PrintSnapshot(std::cout, Telemetry::Snapshot());
+
+			nextTelemetry = timestamp + 5000000;
+		}
+
 		MSG msg;
 		while (::PeekMessage(&msg, nullptr, 0U, 0U, PM_REMOVE))
 		{
@@ -218,50 +400,50 @@ int main()
 			_resizeWidth = _resizeHeight = 0;
 
 			tobiiRender.Resize(_width, _height);
+			rateController.RequestFrame();
 		}
 
 
-		LARGE_INTEGER currentTime;
-		QueryPerformanceCounter(&currentTime);
-
-		// 计算经过的时间
-		auto elapsedTime = static_cast<double>(currentTime.QuadPart - lastTime.QuadPart) / frequency.QuadPart;
-
-		if (elapsedTime >= _frameDuration)
-		{
-			lastTime = currentTime;
-
-			UpdateMousePositionInWindow(hwnd);
-
-
-			{
-				auto isChanged = _mousePos.x != _lastMousePos.x || _mousePos.y != _lastMousePos.y;
+		// 帧率低于 PollRate 时多数节拍只取走采样、看一眼最新的注视点，注视点没有明显移动就接着睡
+		GazeSample latest    = {};
+		auto       hasLatest = tobiiRender.DrainGazeSamples(latest);
 
+		if (isAdaptive && !rateController.IsFrameDue(timestamp, hasLatest ? &latest : nullptr))
+			continue;
 
-#pragma warning(disable: 4018)
-				auto inRect = _mousePos.x >= 0 && _mousePos.x <= _width && _mousePos.y >= 0 && _mousePos.y <= _height;
-#pragma warning(default :4018)
+		// 只算真正渲染的帧，到本次循环结束（包括下面的 continue）为止
+		StageTimer frameTimer(TelemetryStages::Frame);
 
-				//std::cout << "Mouse position in window: (" << _mousePos.x << ", " << _mousePos.y << ")" << std::endl;
+		// 取走采样线程从上一帧到现在推进来的全部采样
+		tobiiRender.ConsumeGazeSamples(timestamp);
+		tobiiRender.AdvanceFrame(timestamp);
 
-				auto isActive = inRect && isChanged;
+		// 场已经衰减到不可见，鼠标再动之前画面不会变化，不必再渲染和 Present
+		auto isChanged = !tobiiRender.IsIdle() && tobiiRender.Render();
 
-				const Point point = {_mousePos.x * 1.0f, _mousePos.y * 1.0f};
+		if (isAdaptive)
+		{
+			const auto& data = tobiiRender.GetRenderData();
 
+			rateController.Update({timestamp, data.HasGaze(), data.HasGaze() ? data.CurrentGaze() : Point{}, tobiiRender.TakeFieldActivity(), tobiiRender.IsIdle()});
+			pacer.SetFrameRate(rateController.GetTickRate());
+		}
 
-				tobiiRender.PushGazePoint(isActive, point);
+		// 累积了但没有超过 8 位量化级的变化，画面与上次 Present 的相同
+		if (!isChanged)
+			continue;
 
-				if (isChanged)
-				{
-					_lastMousePos = _mousePos;
-				}
+		_swapChainOccluded = tobiiRender.Present(0,0) == DXGI_STATUS_OCCLUDED;
+	}
 
+	gazeSource->Stop();
+	timeEndPeriod(1);
 
-				tobiiRender.Render();
-			}
+	GazeSource::PrintStats(std::cout, "Gaze Source", gazeSource->GetStats());
+	FramePacer<>::PrintStats(std::cout, pacer.GetStats());
 
+	if (isAdaptive)
+		FrameRateController::PrintStats(std::cout, rateController.GetStats());
 
-			_swapChainOccluded = tobiiRender.Present(0,0) == DXGI_STATUS_OCCLUDED;
-		}
-	}
+	Telemetry::PrintSnapshot(std::cout, Telemetry::Snapshot());
 }
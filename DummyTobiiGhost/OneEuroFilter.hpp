@@ -0,0 +1,268 @@
+﻿#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Common.h"
+#include "SoftKernels.hpp"
+
+
+enum class SmoothingModes
+{
+	Lerp    = 0x0,
+	OneEuro = 0x1,
+};
+
+struct OneEuroParams
+{
+	float MinCutoff;        // Hz，静止时的截止频率
+	float Beta;             // 每像素/秒的速度让截止频率升高多少 Hz
+	float DerivativeCutoff; // Hz，速度估计本身的平滑
+};
+
+
+// One-Euro 滤波: 截止频率随注视速度变化，注视时强平滑压抖动，扫视时截止频率升高几乎不滞后
+// alpha = r / (r + 1)，r = 2π · cutoff · dt，只有乘除和开方，没有 exp，方便批量处理时向量化
+// 两个轴共用一个速度（速度向量的模），斜向移动时两个轴的滞后一致
+class OneEuroFilter
+{
+public:
+	static constexpr float TwoPi = 6.28318530718f;
+
+	// dt 为 0 时 alpha 为 0，状态不变；求速度时的除数取下限只是为了不产生 Inf
+	static constexpr float MinDt = 1e-6f;
+
+	// Responsiveness 0 ~ 1 与 Lerp 模式同一个滑块: 越大静止时的截止频率越高、随速度升得越快
+	static OneEuroParams FromResponsiveness(float responsiveness)
+	{
+		auto r = std::clamp(responsiveness, 0.0f, 1.0f);
+		return {0.5f + 2.0f * r, 0.001f + 0.02f * r, 1.0f};
+	}
+
+	static float Alpha(float cutoff, float dt)
+	{
+		auto r = TwoPi * cutoff * dt;
+		return r / (r + 1.0f);
+	}
+
+private:
+	OneEuroParams _params = FromResponsiveness(0.25f);
+
+	Point   _value         = {};
+	Point   _derivative    = {};
+	int64_t _lastTimestamp = 0;
+	bool    _hasValue      = false;
+
+public:
+	void SetParams(const OneEuroParams& params) { _params = params; }
+	const OneEuroParams& GetParams() const { return _params; }
+
+	void Reset() { _hasValue = false; }
+
+	bool HasValue() const { return _hasValue; }
+
+	// 一个有效采样，Timestamp 单位为微秒；时间没有前进时保持上一次的结果
+	Point Filter(const GazeSample& sample)
+	{
+		if (!_hasValue)
+		{
+			_value         = sample.Position;
+			_derivative    = {};
+			_lastTimestamp = sample.Timestamp;
+			_hasValue      = true;
+			return _value;
+		}
+
+		if (sample.Timestamp <= _lastTimestamp)
+			return _value;
+
+		auto dt = static_cast<float>(sample.Timestamp - _lastTimestamp) * 1e-6f;
+		_lastTimestamp = sample.Timestamp;
+
+		Step(_params, dt, sample.Position.X, sample.Position.Y, _value.X, _value.Y, _derivative.X, _derivative.Y);
+		return _value;
+	}
+
+	// 单个流的一步，与 OneEuroBatch 各条路径的运算顺序一致，结果逐位相同
+	static void Step(const OneEuroParams& params, float dt, float x, float y, float& valueX, float& valueY, float& derivativeX, float& derivativeY)
+	{
+		auto safeDt = std::max(dt, MinDt);
+
+		auto derivativeAlpha = Alpha(params.DerivativeCutoff, dt);
+		derivativeX += derivativeAlpha * ((x - valueX) / safeDt - derivativeX);
+		derivativeY += derivativeAlpha * ((y - valueY) / safeDt - derivativeY);
+
+		auto speed = std::sqrt(derivativeX * derivativeX + derivativeY * derivativeY);
+		auto alpha = Alpha(params.MinCutoff + params.Beta * speed, dt);
+
+		valueX += alpha * (x - valueX);
+		valueY += alpha * (y - valueY);
+	}
+};
+
+
+// 离线批量处理: 多条同采样率的记录按相同步数一起推进，状态按 SoA 存放，一次 Step 处理所有流
+// 每条流每步可以有自己的 dt（秒），dt 为 0 的流本步保持不变，可以用来跳过无效采样
+class OneEuroBatch
+{
+	using StepKernel = void (*)(const OneEuroParams&, size_t, const float*, const float*, const float*, float*, float*, float*, float*);
+
+	OneEuroParams _params = OneEuroFilter::FromResponsiveness(0.25f);
+
+	std::vector<float> _valueX;
+	std::vector<float> _valueY;
+	std::vector<float> _derivativeX;
+	std::vector<float> _derivativeY;
+
+	StepKernel _kernel = nullptr;
+
+#pragma region Kernels
+	static void StepScalar(const OneEuroParams& params, size_t begin, size_t end, const float* pDt, const float* pX, const float* pY, float* pValueX, float* pValueY, float* pDerivativeX, float* pDerivativeY)
+	{
+		for (auto i = begin; i < end; ++i)
+			OneEuroFilter::Step(params, pDt[i], pX[i], pY[i], pValueX[i], pValueY[i], pDerivativeX[i], pDerivativeY[i]);
+	}
+
+	SOFT_KERNEL_TARGET("sse4.1")
+	static void StepSse41(const OneEuroParams& params, size_t count, const float* pDt, const float* pX, const float* pY, float* pValueX, float* pValueY, float* pDerivativeX, float* pDerivativeY)
+	{
+		auto one              = _mm_set1_ps(1.0f);
+		auto minDt            = _mm_set1_ps(OneEuroFilter::MinDt);
+		auto derivativeCutoff = _mm_set1_ps(OneEuroFilter::TwoPi * params.DerivativeCutoff);
+		auto minCutoff        = _mm_set1_ps(params.MinCutoff);
+		auto beta             = _mm_set1_ps(params.Beta);
+		auto twoPi            = _mm_set1_ps(OneEuroFilter::TwoPi);
+
+		size_t i = 0;
+
+		for (; i + 4 <= count; i += 4)
+		{
+			auto dt          = _mm_loadu_ps(pDt + i);
+			auto x           = _mm_loadu_ps(pX + i);
+			auto y           = _mm_loadu_ps(pY + i);
+			auto valueX      = _mm_loadu_ps(pValueX + i);
+			auto valueY      = _mm_loadu_ps(pValueY + i);
+			auto derivativeX = _mm_loadu_ps(pDerivativeX + i);
+			auto derivativeY = _mm_loadu_ps(pDerivativeY + i);
+
+			auto safeDt = _mm_max_ps(dt, minDt);
+
+			auto r               = _mm_mul_ps(derivativeCutoff, dt);
+			auto derivativeAlpha = _mm_div_ps(r, _mm_add_ps(r, one));
+
+			derivativeX = _mm_add_ps(derivativeX, _mm_mul_ps(derivativeAlpha, _mm_sub_ps(_mm_div_ps(_mm_sub_ps(x, valueX), safeDt), derivativeX)));
+			derivativeY = _mm_add_ps(derivativeY, _mm_mul_ps(derivativeAlpha, _mm_sub_ps(_mm_div_ps(_mm_sub_ps(y, valueY), safeDt), derivativeY)));
+
+			auto speed  = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(derivativeX, derivativeX), _mm_mul_ps(derivativeY, derivativeY)));
+			auto cutoff = _mm_add_ps(minCutoff, _mm_mul_ps(beta, speed));
+
+			r          = _mm_mul_ps(_mm_mul_ps(twoPi, cutoff), dt);
+			auto alpha = _mm_div_ps(r, _mm_add_ps(r, one));
+
+			_mm_storeu_ps(pValueX + i, _mm_add_ps(valueX, _mm_mul_ps(alpha, _mm_sub_ps(x, valueX))));
+			_mm_storeu_ps(pValueY + i, _mm_add_ps(valueY, _mm_mul_ps(alpha, _mm_sub_ps(y, valueY))));
+			_mm_storeu_ps(pDerivativeX + i, derivativeX);
+			_mm_storeu_ps(pDerivativeY + i, derivativeY);
+		}
+
+		StepScalar(params, i, count, pDt, pX, pY, pValueX, pValueY, pDerivativeX, pDerivativeY);
+	}
+
+	SOFT_KERNEL_TARGET("avx2")
+	static void StepAvx2(const OneEuroParams& params, size_t count, const float* pDt, const float* pX, const float* pY, float* pValueX, float* pValueY, float* pDerivativeX, float* pDerivativeY)
+	{
+		auto one              = _mm256_set1_ps(1.0f);
+		auto minDt            = _mm256_set1_ps(OneEuroFilter::MinDt);
+		auto derivativeCutoff = _mm256_set1_ps(OneEuroFilter::TwoPi * params.DerivativeCutoff);
+		auto minCutoff        = _mm256_set1_ps(params.MinCutoff);
+		auto beta             = _mm256_set1_ps(params.Beta);
+		auto twoPi            = _mm256_set1_ps(OneEuroFilter::TwoPi);
+
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8)
+		{
+			auto dt          = _mm256_loadu_ps(pDt + i);
+			auto x           = _mm256_loadu_ps(pX + i);
+			auto y           = _mm256_loadu_ps(pY + i);
+			auto valueX      = _mm256_loadu_ps(pValueX + i);
+			auto valueY      = _mm256_loadu_ps(pValueY + i);
+			auto derivativeX = _mm256_loadu_ps(pDerivativeX + i);
+			auto derivativeY = _mm256_loadu_ps(pDerivativeY + i);
+
+			auto safeDt = _mm256_max_ps(dt, minDt);
+
+			auto r               = _mm256_mul_ps(derivativeCutoff, dt);
+			auto derivativeAlpha = _mm256_div_ps(r, _mm256_add_ps(r, one));
+
+			derivativeX = _mm256_add_ps(derivativeX, _mm256_mul_ps(derivativeAlpha, _mm256_sub_ps(_mm256_div_ps(_mm256_sub_ps(x, valueX), safeDt), derivativeX)));
+			derivativeY = _mm256_add_ps(derivativeY, _mm256_mul_ps(derivativeAlpha, _mm256_sub_ps(_mm256_div_ps(_mm256_sub_ps(y, valueY), safeDt), derivativeY)));
+
+			auto speed  = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(derivativeX, derivativeX), _mm256_mul_ps(derivativeY, derivativeY)));
+			auto cutoff = _mm256_add_ps(minCutoff, _mm256_mul_ps(beta, speed));
+
+			r          = _mm256_mul_ps(_mm256_mul_ps(twoPi, cutoff), dt);
+			auto alpha = _mm256_div_ps(r, _mm256_add_ps(r, one));
+
+			_mm256_storeu_ps(pValueX + i, _mm256_add_ps(valueX, _mm256_mul_ps(alpha, _mm256_sub_ps(x, valueX))));
+			_mm256_storeu_ps(pValueY + i, _mm256_add_ps(valueY, _mm256_mul_ps(alpha, _mm256_sub_ps(y, valueY))));
+			_mm256_storeu_ps(pDerivativeX + i, derivativeX);
+			_mm256_storeu_ps(pDerivativeY + i, derivativeY);
+		}
+
+		StepScalar(params, i, count, pDt, pX, pY, pValueX, pValueY, pDerivativeX, pDerivativeY);
+	}
+
+	static void StepScalarAll(const OneEuroParams& params, size_t count, const float* pDt, const float* pX, const float* pY, float* pValueX, float* pValueY, float* pDerivativeX, float* pDerivativeY)
+	{
+		StepScalar(params, 0, count, pDt, pX, pY, pValueX, pValueY, pDerivativeX, pDerivativeY);
+	}
+#pragma endregion
+
+public:
+	explicit OneEuroBatch(SimdLevel level = SoftKernels::ActiveSimdLevel())
+	{
+		SetSimdLevel(level);
+	}
+
+	// 不超过 CPU 实际支持的级别
+	void SetSimdLevel(SimdLevel level)
+	{
+		switch (std::min(level, SoftKernels::ActiveSimdLevel()))
+		{
+			case SimdLevel::Avx2:
+				_kernel = StepAvx2;
+				break;
+			case SimdLevel::Sse41:
+				_kernel = StepSse41;
+				break;
+			default:
+				_kernel = StepScalarAll;
+				break;
+		}
+	}
+
+	void SetParams(const OneEuroParams& params) { _params = params; }
+	const OneEuroParams& GetParams() const { return _params; }
+
+	// 用每条流的第一个采样初始化
+	void Start(size_t streamCount, const float* pX, const float* pY)
+	{
+		_valueX.assign(pX, pX + streamCount);
+		_valueY.assign(pY, pY + streamCount);
+		_derivativeX.assign(streamCount, 0.0f);
+		_derivativeY.assign(streamCount, 0.0f);
+	}
+
+	// 所有流前进一步，结果通过 GetValueX/GetValueY 读取
+	void Step(const float* pDt, const float* pX, const float* pY)
+	{
+		_kernel(_params, _valueX.size(), pDt, pX, pY, _valueX.data(), _valueY.data(), _derivativeX.data(), _derivativeY.data());
+	}
+
+	size_t       GetStreamCount() const { return _valueX.size(); }
+	const float* GetValueX() const { return _valueX.data(); }
+	const float* GetValueY() const { return _valueY.data(); }
+};
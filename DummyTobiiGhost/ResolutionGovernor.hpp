@@ -0,0 +1,93 @@
+﻿#pragma once
+#include <cstdint>
+
+
+// 按实测的累积 + 合成耗时在 2/4/8/16 四档降采样倍数之间切换，和游戏一起跑时主动降低自身开销
+// 耗时近似与场的像素数成正比，降一档（倍数 x2）约为 1/4；升档前按 4 倍预估，留出余量避免来回跳
+class ResolutionGovernor
+{
+public:
+	static constexpr uint32_t LevelCount           = 4;
+	static constexpr uint32_t Levels[LevelCount]   = {2, 4, 8, 16};
+	static constexpr uint32_t DefaultLevel         = 1;
+	static constexpr double   SmoothingFactor      = 0.1;
+	static constexpr double   UpgradeHeadroom      = 0.75;
+	static constexpr uint32_t SettleFrames         = 30;
+
+private:
+	double   _budget       = 0.0;
+	double   _averageCost  = 0.0;
+	uint32_t _level        = DefaultLevel;
+	uint32_t _settleFrames = 0;
+
+	void SwitchLevel(uint32_t level)
+	{
+		// 切档后按像素数比例预估新档位的耗时，再由后续实测修正
+		auto ratio = static_cast<double>(Levels[_level]) / static_cast<double>(Levels[level]);
+
+		_averageCost *= ratio * ratio;
+		_level        = level;
+		_settleFrames = SettleFrames;
+	}
+
+public:
+	// budget 为每帧允许的秒数，0 表示关闭调节，保持当前倍数
+	void SetBudget(double budget)
+	{
+		_budget       = budget;
+		_averageCost  = 0.0;
+		_settleFrames = SettleFrames;
+	}
+
+	// 喂入一帧的实测耗时（秒），倍数变化时返回 true
+	bool Update(double seconds)
+	{
+		if (_budget <= 0.0)
+			return false;
+
+		_averageCost = _averageCost == 0.0 ? seconds : _averageCost + (seconds - _averageCost) * SmoothingFactor;
+
+		if (_settleFrames > 0)
+		{
+			--_settleFrames;
+			return false;
+		}
+
+		if (_averageCost > _budget && _level + 1 < LevelCount)
+		{
+			SwitchLevel(_level + 1);
+			return true;
+		}
+
+		if (_averageCost * 4.0 < _budget * UpgradeHeadroom && _level > 0)
+		{
+			SwitchLevel(_level - 1);
+			return true;
+		}
+
+		return false;
+	}
+
+	// 不在档位里的倍数取不小于它的最近一档
+	void SetDownsampleFactor(uint32_t factor)
+	{
+		_level = LevelCount - 1;
+
+		for (uint32_t i = 0; i < LevelCount; ++i)
+		{
+			if (Levels[i] >= factor)
+			{
+				_level = i;
+				break;
+			}
+		}
+
+		_averageCost  = 0.0;
+		_settleFrames = SettleFrames;
+	}
+
+
+	uint32_t GetDownsampleFactor() const { return Levels[_level]; }
+	double   GetBudget() const { return _budget; }
+	double   GetAverageCost() const { return _averageCost; }
+};
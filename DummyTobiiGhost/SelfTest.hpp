@@ -0,0 +1,593 @@
+﻿#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "Common.h"
+#include "FieldChangeTracker.hpp"
+#include "FrameRateController.hpp"
+#include "GazeReplay.hpp"
+#include "SoftKernels.hpp"
+#include "SoftRender.hpp"
+
+
+// 不需要 D3D11 设备的正确性检查，--selftest 时运行，全部通过返回 0
+namespace SelfTest
+{
+	// 按 Shader 源码逐句抄写的 float 参考实现，与 SoftKernels 相互独立，只共用 PSConstantData
+	// uv 为像素中心，GPU 在纹素中心线性采样取到的就是原值
+	namespace Reference
+	{
+		static float Saturate(float value)
+		{
+			return value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f;
+		}
+
+		// D3D11 允许 float32 运算把非规格化数当作 0，SoftKernels 写回时按 0 处理
+		static float FlushDenormal(float value)
+		{
+			return value >= FLT_MIN ? value : 0.0f;
+		}
+
+		// HeatmapPixelShader.hlsl
+		static float HeatmapPixel(float tex, const PSConstantData& data, float distSquared)
+		{
+			float normalizedDist = Saturate(distSquared / data.SizeSquared);
+
+			normalizedDist = 1.0f - normalizedDist;
+
+			normalizedDist *= 0.03f;
+
+			return FlushDenormal(tex * Saturate(data.Decay) + normalizedDist);
+		}
+
+		// BubblePixelShader.hlsl
+		static float BubblePixel(float tex, const PSConstantData& data, float distSquared)
+		{
+			float isInsideCircle = (distSquared < (data.AspectRatio * data.AspectRatio)) ? 1.0f : 0.0f;
+
+			isInsideCircle *= 1.0f - data.Trail;
+
+			isInsideCircle *= Saturate((distSquared - data.SizeSquared) * 4.0f);
+
+			isInsideCircle = Saturate(isInsideCircle * -5.0f + data.Decay);
+
+			float normalizedDist = Saturate(distSquared / data.SizeSquared);
+
+			normalizedDist = 1.0f - normalizedDist;
+
+			normalizedDist *= 1.7f;
+
+			return FlushDenormal(tex * isInsideCircle + normalizedDist);
+		}
+
+		// SolidPixelShader.hlsl
+		static float SolidPixel(float tex, const PSConstantData& data, float)
+		{
+			return FlushDenormal(tex * data.Decay);
+		}
+
+		// offset = (gazePointUV - uv) * float2(aspectRatio, 1.0f); dot(offset, offset)
+		static float PointDistSquared(const PSConstantData& data, Point, float u, float v)
+		{
+			float offsetX = (data.GazePoint.X - u) * data.AspectRatio;
+			float offsetY = (data.GazePoint.Y - v) * 1.0f;
+
+			return offsetX * offsetX + offsetY * offsetY;
+		}
+
+		// 胶囊没有对应的 Shader: 像素到线段 [start, gazePointUV] 的距离平方，与 SoftKernels 一样先求长度平方的倒数再乘
+		static float CapsuleDistSquared(const PSConstantData& data, Point start, float u, float v)
+		{
+			float apX = (u - start.X) * data.AspectRatio;
+			float apY = (v - start.Y) * 1.0f;
+			float abX = (data.GazePoint.X - start.X) * data.AspectRatio;
+			float abY = (data.GazePoint.Y - start.Y) * 1.0f;
+
+			float lengthSq    = abX * abX + abY * abY;
+			float invLengthSq = lengthSq > 0.0f ? 1.0f / lengthSq : 0.0f;
+
+			float t       = Saturate((apX * abX + apY * abY) * invLengthSq);
+			float offsetX = apX - abX * t;
+			float offsetY = apY - abY * t;
+
+			return offsetX * offsetX + offsetY * offsetY;
+		}
+	}
+
+
+	typedef float (*ReferencePixel)(float tex, const PSConstantData& data, float distSquared);
+	typedef float (*ReferenceDistance)(const PSConstantData& data, Point start, float u, float v);
+	typedef SplatParams (*KernelParams)(const PSConstantData& data, Point start);
+
+	// 两个 float 之间隔了多少个可表示的值，同号相邻为 1，+0 与 -0 为 0
+	static uint32_t UlpDistance(float a, float b)
+	{
+		auto toOrdered = [](float value)
+		{
+			int32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			return bits < 0 ? INT32_MIN - bits : bits;
+		};
+
+		auto difference = static_cast<int64_t>(toOrdered(a)) - static_cast<int64_t>(toOrdered(b));
+		return static_cast<uint32_t>(std::min<int64_t>(difference < 0 ? -difference : difference, UINT32_MAX));
+	}
+
+	// 固定种子，每次运行的输入都相同
+	class TestRandom
+	{
+		std::mt19937 _engine;
+
+	public:
+		explicit TestRandom(uint32_t seed) : _engine(seed)
+		{
+		}
+
+		float Uniform(float min, float max)
+		{
+			return min + (max - min) * static_cast<float>(static_cast<double>(_engine()) / 4294967296.0);
+		}
+
+		uint32_t Below(uint32_t count) { return static_cast<uint32_t>(static_cast<uint64_t>(_engine()) * count >> 32); }
+	};
+
+	// 注视点可以落在画面外，衰减可以超出 [0, 1]，测到 Saturate 的两端
+	static PSConstantData RandomConstantData(TestRandom& random)
+	{
+		PSConstantData data = {};
+		data.GazePoint      = {random.Uniform(-0.2f, 1.2f), random.Uniform(-0.2f, 1.2f)};
+		data.AspectRatio    = random.Uniform(0.5f, 3.0f);
+		data.SizeSquared    = random.Uniform(1e-4f, 0.1f);
+		data.Trail          = random.Uniform(0.0f, 1.0f);
+		data.Decay          = random.Uniform(-0.2f, 1.2f);
+		data.GainScale      = 1.0f; // Shader 里没有 GainScale，GPU 路径上总是 1
+		return data;
+	}
+
+	static const uint32_t SplatTrialCount = 400;
+
+	// 在随机尺寸的场上每行随机取一段 [x0, x1) 执行 kernel，段内与参考实现相差不超过 1 ulp，段外不变
+	static bool SplatKernel(std::ostream& out, const char* name, SplatRowKernel (*getKernel)(SimdLevel), KernelParams makeParams, ReferencePixel reference, ReferenceDistance distance)
+	{
+		auto isPassed = true;
+
+		for (auto level : {SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2})
+		{
+			if (level > SoftKernels::ActiveSimdLevel())
+				break;
+
+			TestRandom random(20240611);
+
+			auto     kernel     = getKernel(level);
+			uint64_t pixelCount = 0;
+			uint32_t maxUlp     = 0;
+			uint64_t failCount  = 0;
+
+			std::vector<float> field;
+			std::vector<float> original;
+
+			for (uint32_t trial = 0; trial < SplatTrialCount; ++trial)
+			{
+				auto width  = 1 + random.Below(97);
+				auto height = 1 + random.Below(33);
+
+				auto  data   = RandomConstantData(random);
+				Point start  = {random.Uniform(-0.2f, 1.2f), random.Uniform(-0.2f, 1.2f)};
+				auto  params = makeParams(data, start);
+
+				// 约十分之一的像素为 0，其余为正常的场值
+				field.resize(static_cast<size_t>(width) * height);
+
+				for (auto& value : field)
+					value = random.Below(10) == 0 ? 0.0f : random.Uniform(0.0f, 2.0f);
+
+				original = field;
+
+				for (uint32_t y = 0; y < height; ++y)
+				{
+					auto x0   = random.Below(width + 1);
+					auto x1   = x0 + random.Below(width - x0 + 1);
+					auto pRow = field.data() + static_cast<size_t>(y) * width;
+					auto pOld = original.data() + static_cast<size_t>(y) * width;
+
+					kernel(pRow + x0, y, x0, x1, width, height, params);
+
+					auto v = (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+
+					for (uint32_t x = 0; x < width; ++x)
+					{
+						auto u        = (static_cast<float>(x) + 0.5f) / static_cast<float>(width);
+						auto expected = x >= x0 && x < x1 ? reference(pOld[x], data, distance(data, start, u, v)) : pOld[x];
+						auto ulp      = UlpDistance(pRow[x], expected);
+
+						maxUlp = std::max(maxUlp, ulp);
+
+						if (ulp > 1)
+						{
+							if (failCount == 0)
+							{
+								out << "  " << name << " " << SoftKernels::SimdLevelName(level) << " mismatch at (" << x << ", " << y << ") of " << width << "x" << height << ": " << std::setprecision(9)
+									<< pRow[x] << " vs " << expected << std::endl;
+							}
+
+							++failCount;
+						}
+					}
+
+					pixelCount += x1 - x0;
+				}
+			}
+
+			out << "  " << std::left << std::setw(24) << name << std::setw(8) << SoftKernels::SimdLevelName(level) << std::right << std::setw(10) << pixelCount << " pixels, max " << maxUlp << " ulp"
+				<< (failCount == 0 ? "" : ", FAILED") << std::endl;
+
+			isPassed = isPassed && failCount == 0;
+		}
+
+		return isPassed;
+	}
+
+	static bool SplatKernels(std::ostream& out)
+	{
+		out << "Splat kernels vs HLSL reference (1 ulp)" << std::endl;
+
+		auto heatmap = [](const PSConstantData& data, Point) { return SoftKernels::HeatmapParams(data); };
+		auto bubble  = [](const PSConstantData& data, Point) { return SoftKernels::BubbleParams(data); };
+		auto solid   = [](const PSConstantData& data, Point) { return SoftKernels::SolidParams(data); };
+
+		auto heatmapCapsule = [](const PSConstantData& data, Point start) { return SoftKernels::CapsuleParams(SoftKernels::HeatmapParams(data), start); };
+		auto bubbleCapsule  = [](const PSConstantData& data, Point start) { return SoftKernels::CapsuleParams(SoftKernels::BubbleParams(data), start); };
+
+		auto isPassed = true;
+
+		isPassed &= SplatKernel(out, "heatmap", SoftKernels::HeatmapRowKernel, heatmap, Reference::HeatmapPixel, Reference::PointDistSquared);
+		isPassed &= SplatKernel(out, "bubble", SoftKernels::BubbleRowKernel, bubble, Reference::BubblePixel, Reference::PointDistSquared);
+		isPassed &= SplatKernel(out, "solid", SoftKernels::SolidRowKernel, solid, Reference::SolidPixel, Reference::PointDistSquared);
+		isPassed &= SplatKernel(out, "heatmap capsule", SoftKernels::HeatmapCapsuleRowKernel, heatmapCapsule, Reference::HeatmapPixel, Reference::CapsuleDistSquared);
+		isPassed &= SplatKernel(out, "bubble capsule", SoftKernels::BubbleCapsuleRowKernel, bubbleCapsule, Reference::BubblePixel, Reference::CapsuleDistSquared);
+
+		return isPassed;
+	}
+
+	static bool IsSameRect(const FieldRect& a, const FieldRect& b)
+	{
+		return a.Left == b.Left && a.Top == b.Top && a.Right == b.Right && a.Bottom == b.Bottom;
+	}
+
+	static std::ostream& operator<<(std::ostream& out, const FieldRect& rect)
+	{
+		return out << "[" << rect.Left << ", " << rect.Top << ", " << rect.Right << ", " << rect.Bottom << ")";
+	}
+
+	// 清掉之前的变化，只让 tileRects（块坐标）里的块变脏
+	static void MarkTilesDirty(FieldChangeTracker& tracker, std::initializer_list<FieldRect> tileRects)
+	{
+		tracker.MarkClean();
+
+		for (const auto& tileRect : tileRects)
+		{
+			FieldRect fieldRect = {tileRect.Left * FieldChangeTracker::TileSize, tileRect.Top * FieldChangeTracker::TileSize, std::min(tileRect.Right * FieldChangeTracker::TileSize, tracker.GetFieldWidth()),
+			                       std::min(tileRect.Bottom * FieldChangeTracker::TileSize, tracker.GetFieldHeight())};
+
+			tracker.TrackPass(1.0f, 1.0f, 1.0f, fieldRect);
+		}
+	}
+
+	// 块坐标的矩形换成输出坐标，即 CollectDirtyRects 应当给出的结果
+	static FieldRect TilesToOutput(const FieldChangeTracker& tracker, const FieldRect& tileRect, uint32_t outputWidth, uint32_t outputHeight)
+	{
+		FieldRect fieldRect = {tileRect.Left * FieldChangeTracker::TileSize, tileRect.Top * FieldChangeTracker::TileSize, std::min(tileRect.Right * FieldChangeTracker::TileSize, tracker.GetFieldWidth()),
+		                       std::min(tileRect.Bottom * FieldChangeTracker::TileSize, tracker.GetFieldHeight())};
+
+		return FieldChangeTracker::FieldToOutputRect(fieldRect, tracker.GetFieldWidth(), tracker.GetFieldHeight(), outputWidth, outputHeight);
+	}
+
+	static bool CheckRects(std::ostream& out, const char* name, const std::vector<FieldRect>& rects, const std::vector<FieldRect>& expected)
+	{
+		auto isPassed = std::equal(rects.begin(), rects.end(), expected.begin(), expected.end(), IsSameRect);
+
+		out << "  " << std::left << std::setw(32) << name << std::right << std::setw(3) << rects.size() << " rects" << (isPassed ? "" : ", FAILED") << std::endl;
+
+		if (!isPassed)
+		{
+			for (const auto& rect : rects)
+				out << "    got " << rect << std::endl;
+
+			for (const auto& rect : expected)
+				out << "    expected " << rect << std::endl;
+		}
+
+		return isPassed;
+	}
+
+	// 场 330x200（最后一列、最后一行块不满）上采样到 1320x800
+	static bool DirtyRectMerging(std::ostream& out)
+	{
+		out << "Dirty rect merging" << std::endl;
+
+		const uint32_t outputWidth  = 1320;
+		const uint32_t outputHeight = 800;
+
+		FieldChangeTracker tracker;
+		tracker.Reset(330, 200);
+
+		std::vector<FieldRect> rects;
+
+		auto collect = [&]() -> const std::vector<FieldRect>&
+		{
+			rects.clear();
+			tracker.CollectDirtyRects(outputWidth, outputHeight, rects);
+			return rects;
+		};
+
+		auto toOutput = [&](const FieldRect& tileRect) { return TilesToOutput(tracker, tileRect, outputWidth, outputHeight); };
+
+		auto isPassed = true;
+
+		isPassed &= CheckRects(out, "all dirty -> full screen", collect(), {{0, 0, outputWidth, outputHeight}});
+
+		MarkTilesDirty(tracker, {});
+		isPassed &= CheckRects(out, "clean -> none", collect(), {});
+
+		// 同一段在相邻几行上合成一个矩形
+		MarkTilesDirty(tracker, {{2, 1, 5, 4}});
+		isPassed &= CheckRects(out, "block spanning rows", collect(), {toOutput({2, 1, 5, 4})});
+
+		// 下一行的段左右边界不同，另起一个矩形，上面的矩形不再延伸
+		MarkTilesDirty(tracker, {{2, 1, 5, 3}, {3, 3, 7, 4}, {2, 4, 5, 5}});
+		isPassed &= CheckRects(out, "spans with different bounds", collect(), {toOutput({2, 1, 5, 3}), toOutput({3, 3, 7, 4}), toOutput({2, 4, 5, 5})});
+
+		// 一行里两段分开的脏块
+		MarkTilesDirty(tracker, {{0, 2, 2, 4}, {5, 2, 7, 4}});
+		isPassed &= CheckRects(out, "two spans in a row", collect(), {toOutput({0, 2, 2, 4}), toOutput({5, 2, 7, 4})});
+
+		// 最后一列、最后一行的块不满，矩形截到场的边界
+		MarkTilesDirty(tracker, {{9, 5, 11, 7}});
+		isPassed &= CheckRects(out, "partial edge tiles", collect(), {toOutput({9, 5, 11, 7})});
+
+		// 超过 MaxDirtyRects 个互不相连的块，退化为一个包围盒
+		MarkTilesDirty(tracker, {{0, 0, 1, 1}, {2, 0, 3, 1}, {4, 0, 5, 1}, {6, 0, 7, 1}, {8, 0, 9, 1}, {1, 2, 2, 3}, {3, 2, 4, 3}, {5, 2, 6, 3}, {7, 4, 8, 5}});
+		isPassed &= CheckRects(out, "bounding box fallback", collect(), {toOutput({0, 0, 9, 5})});
+
+		MarkTilesDirty(tracker, {{0, 0, 1, 1}, {2, 0, 3, 1}, {4, 0, 5, 1}, {6, 0, 7, 1}, {8, 0, 9, 1}, {1, 2, 2, 3}, {3, 2, 4, 3}, {5, 2, 6, 3}});
+		isPassed &= CheckRects(out, "MaxDirtyRects kept", collect(), {toOutput({0, 0, 1, 1}), toOutput({2, 0, 3, 1}), toOutput({4, 0, 5, 1}), toOutput({6, 0, 7, 1}), toOutput({8, 0, 9, 1}),
+		                                                                  toOutput({1, 2, 2, 3}), toOutput({3, 2, 4, 3}), toOutput({5, 2, 6, 3})});
+
+		tracker.MarkAllDirty();
+		isPassed &= CheckRects(out, "MarkAllDirty -> full screen", collect(), {{0, 0, outputWidth, outputHeight}});
+
+		return isPassed;
+	}
+
+	// FieldToOutputRect 要覆盖所有双线性采样读到 [Left, Right) 内场值的输出像素，逐个像素按采样位置暴力检查
+	static bool FieldToOutputFootprint(std::ostream& out)
+	{
+		TestRandom random(7);
+
+		uint64_t checkCount = 0;
+		uint64_t missCount  = 0;
+
+		for (uint32_t trial = 0; trial < 2000; ++trial)
+		{
+			auto fieldSize  = 1 + random.Below(200);
+			auto outputSize = fieldSize * (1 + random.Below(8)) + random.Below(8);
+			auto left       = random.Below(fieldSize);
+			auto right      = left + 1 + random.Below(fieldSize - left);
+
+			// 只检查一个方向，另一个方向的计算相同
+			auto rect = FieldChangeTracker::FieldToOutputRect({left, 0, right, 1}, fieldSize, 1, outputSize, 1);
+
+			for (uint32_t x = 0; x < outputSize; ++x)
+			{
+				auto tap      = SoftKernels::MakeBilinearTap(x, outputSize, fieldSize);
+				auto isInside = x >= rect.Left && x < rect.Right;
+
+				// 边缘处采样位置被截断，第二个采样点权重为 0，不影响输出
+				auto isRead = (tap.Weight < 1.0f && tap.Index0 >= left && tap.Index0 < right) || (tap.Weight > 0.0f && tap.Index1 >= left && tap.Index1 < right);
+
+				++checkCount;
+
+				if (isRead && !isInside)
+				{
+					if (missCount == 0)
+						out << "  footprint miss: field [" << left << ", " << right << ") of " << fieldSize << " -> output " << x << " of " << outputSize << ", rect [" << rect.Left << ", " << rect.Right << ")" << std::endl;
+
+					++missCount;
+				}
+			}
+		}
+
+		out << "  " << std::left << std::setw(32) << "bilinear footprint" << std::right << std::setw(10) << checkCount << " pixels" << (missCount == 0 ? "" : ", FAILED") << std::endl;
+		return missCount == 0;
+	}
+
+	static uint32_t MaxChannelDifference(uint32_t a, uint32_t b)
+	{
+		uint32_t difference = 0;
+
+		for (uint32_t channel = 0; channel < 32; channel += 8)
+		{
+			auto channelA = static_cast<int>(a >> channel & 0xFF);
+			auto channelB = static_cast<int>(b >> channel & 0xFF);
+
+			difference = std::max<uint32_t>(difference, static_cast<uint32_t>(channelA > channelB ? channelA - channelB : channelB - channelA));
+		}
+
+		return difference;
+	}
+
+	// 逐帧整屏合成一遍当作真实画面，与上一帧的真实画面比较: 变化超过 CompositeTolerance 允许的一个量化级的像素都要落在脏矩形里
+	// 同时只按脏矩形更新的画面与真实画面相差不超过一个量化级
+	static bool DirtyRectCoverage(std::ostream& out, const char* name, ShapeTypes shapeType, uint32_t downsampleFactor)
+	{
+		const uint32_t width  = 480;
+		const uint32_t height = 270;
+
+		SoftRender render(width, height);
+		render.SetDownsampleFactor(downsampleFactor);
+
+		TobiiRenderSettings settings = {};
+		settings.ShapeType           = shapeType;
+		render.UpdateSettings(settings);
+
+		std::vector<uint32_t> partial(static_cast<size_t>(width) * height);
+		std::vector<uint32_t> previous(partial.size());
+		std::vector<uint32_t> full(partial.size());
+
+		render.Render();
+		render.Composite(partial.data(), width);
+		previous = partial;
+
+		TestRandom random(shapeType * 16 + downsampleFactor);
+
+		Point    gaze             = {width * 0.5f, height * 0.5f};
+		uint32_t changedCount    = 0;
+		uint32_t maxOutside      = 0;
+		uint32_t maxPartialError = 0;
+		uint64_t dirtyPixelCount = 0;
+		uint32_t frameCount      = 0;
+
+		// 注视、扫视、注视点丢失后只剩衰减，最后一段让场完全收敛
+		for (uint32_t frame = 0; frame < 400; ++frame)
+		{
+			auto isActive = frame < 250 && frame % 50 < 40;
+
+			if (random.Below(20) == 0)
+				gaze = {random.Uniform(0.0f, static_cast<float>(width)), random.Uniform(0.0f, static_cast<float>(height))};
+			else
+				gaze = {std::clamp(gaze.X + random.Uniform(-4.0f, 4.0f), 0.0f, static_cast<float>(width)), std::clamp(gaze.Y + random.Uniform(-4.0f, 4.0f), 0.0f, static_cast<float>(height))};
+
+			render.PushGazePoint(isActive, gaze);
+			render.Render();
+
+			const auto& rects = render.GetDirtyRects();
+
+			render.CompositeRect(full.data(), width, {0, 0, width, height});
+
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					auto index = static_cast<size_t>(y) * width + x;
+
+					if (full[index] == previous[index])
+						continue;
+
+					++changedCount;
+
+					auto isInside = std::any_of(rects.begin(), rects.end(), [&](const FieldRect& rect) { return x >= rect.Left && x < rect.Right && y >= rect.Top && y < rect.Bottom; });
+
+					if (!isInside)
+						maxOutside = std::max(maxOutside, MaxChannelDifference(full[index], partial[index]));
+				}
+			}
+
+			for (const auto& rect : rects)
+				dirtyPixelCount += static_cast<uint64_t>(rect.Right - rect.Left) * (rect.Bottom - rect.Top);
+
+			render.Composite(partial.data(), width);
+
+			for (size_t i = 0; i < full.size(); ++i)
+				maxPartialError = std::max(maxPartialError, MaxChannelDifference(full[i], partial[i]));
+
+			previous = full;
+			++frameCount;
+		}
+
+		auto isPassed = maxOutside <= 1 && maxPartialError <= 1;
+
+		out << "  " << std::left << std::setw(32) << name << std::right << std::setw(10) << changedCount << " changed, " << std::fixed << std::setprecision(1)
+			<< 100.0 * static_cast<double>(dirtyPixelCount) / (static_cast<double>(width) * height * frameCount) << "% recomposited, outside " << maxOutside << ", stale " << maxPartialError
+			<< (isPassed ? "" : ", FAILED") << std::endl;
+
+		out << std::defaultfloat;
+		return isPassed;
+	}
+
+	static bool DirtyRects(std::ostream& out)
+	{
+		auto isPassed = DirtyRectMerging(out);
+
+		isPassed &= FieldToOutputFootprint(out);
+
+		out << "Dirty rects vs full composite (max channel error, 8-bit levels)" << std::endl;
+
+		isPassed &= DirtyRectCoverage(out, "heatmap", Heatmap, 4);
+		isPassed &= DirtyRectCoverage(out, "heatmap, full resolution", Heatmap, 1);
+		isPassed &= DirtyRectCoverage(out, "bubble", Bubble, 4);
+		isPassed &= DirtyRectCoverage(out, "bubble, downsample 3", Bubble, 3);
+
+		return isPassed;
+	}
+
+	// 自适应帧率回放: 1 s 移动的注视点，3 s 只有无效采样（跟踪丢失，场衰减到空闲、停止渲染），再 2 s 移动的注视点
+	// 停止渲染的节拍也要取走采样，否则环形缓冲被无效采样填满，之后的有效采样全部丢掉，再也不会醒来
+	static bool AdaptiveRateRecovery(std::ostream& out)
+	{
+		out << "Adaptive frame rate after tracking loss" << std::endl;
+
+		SoftRender render(640, 360);
+
+		TobiiRenderSettings settings = {};
+		settings.TimeBasedDecay      = true;
+		render.UpdateSettings(settings);
+
+		FrameRateController controller(FrameRateParams::FromPolicy(PowerPolicies::Balanced));
+
+		const int64_t start     = 1000000;
+		const int64_t lossBegin = start + 1000000;
+		const int64_t lossEnd   = start + 4000000;
+		const int64_t end       = start + 6000000;
+
+		uint32_t afterFrames = 0;
+
+		ReplayOptions options  = {};
+		options.FrameInterval  = 1;
+		options.RateController = &controller;
+
+		GazeReplay replay(render, options, [&](SoftRender& renderer, int64_t timestamp)
+		{
+			if (timestamp >= lossEnd && renderer.GetRenderData().HasGaze())
+				++afterFrames;
+		});
+
+		// 1200 Hz，每秒在屏幕上绕一圈
+		for (auto timestamp = start; timestamp < end; timestamp += 833)
+		{
+			auto angle = static_cast<float>(timestamp - start) * 1e-6f * 6.2831853f;
+			auto valid = timestamp < lossBegin || timestamp >= lossEnd;
+
+			replay.AddSample({timestamp, {320.0f + 200.0f * std::cos(angle), 180.0f + 120.0f * std::sin(angle)}, valid});
+		}
+
+		replay.Finish();
+
+		auto dropped  = render.GetGazeRing().GetDroppedCount();
+		auto stopped  = controller.GetStats().StopCount;
+		// 恢复后的 2 s 注视点一直在动，帧率不会低于 PollRate
+		auto isPassed = stopped > 0 && afterFrames >= 2 * 60 && dropped == 0;
+
+		out << "  " << std::left << std::setw(32) << "stop -> invalid -> valid" << std::right << std::setw(6) << afterFrames << " frames after, " << stopped << " stops, " << dropped << " dropped"
+			<< (isPassed ? "" : ", FAILED") << std::endl;
+
+		return isPassed;
+	}
+
+	static bool RunAll(std::ostream& out)
+	{
+		auto isPassed = true;
+
+		isPassed &= SplatKernels(out);
+		isPassed &= DirtyRects(out);
+		isPassed &= AdaptiveRateRecovery(out);
+
+		out << (isPassed ? "All self tests passed" : "Self tests FAILED") << std::endl;
+		return isPassed;
+	}
+}
@@ -0,0 +1,1016 @@
+﻿#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "Common.h"
+
+// MSVC 允许在任意函数里直接使用 AVX2 intrinsic，GCC/Clang 需要逐函数打开目标指令集
+#if defined(_MSC_VER)
+#define SOFT_KERNEL_TARGET(isa)
+#else
+#define SOFT_KERNEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+
+enum class SimdLevel
+{
+	Scalar = 0x0,
+	Sse41  = 0x1,
+	Avx2   = 0x2,
+};
+
+// 与 HLSL 里 cbuffer 的字段一一对应，Gain 是各 Shader 里写死的那个系数
+struct SplatParams
+{
+	float GazeU;
+	float GazeV;
+	float AspectRatio;
+	float SizeSquared;
+	float Trail;
+	float Decay;
+	float Gain;
+
+	// 胶囊 splat 的线段终点，圆形 splat 时与 GazeU/GazeV 相同
+	float EndU;
+	float EndV;
+};
+
+// 场上的像素矩形，Right/Bottom 不包含
+struct FieldRect
+{
+	uint32_t Left;
+	uint32_t Top;
+	uint32_t Right;
+	uint32_t Bottom;
+
+	bool IsEmpty() const { return Left >= Right || Top >= Bottom; }
+};
+
+// NormalBlendPixelShader / HeatmapBlendPixelShader 里除场值以外的输入，pShapePixels 为 R8G8B8A8 的形状纹理
+struct CompositeParams
+{
+	const uint32_t* pShapePixels;
+	uint32_t        ShapeWidth;
+	OverlayColor    Color;
+	OverlayColor    BackgroundColor;
+	bool            IsHeatmap;
+};
+
+// 处理第 y 行的 [x0, x1) 列，pRow 指向第 x0 列；uv 按整张 width x height 的场计算
+typedef void (*SplatRowKernel)(float* pRow, uint32_t y, uint32_t x0, uint32_t x1, uint32_t width, uint32_t height, const SplatParams& params);
+typedef float (*ScaleMaxKernel)(float* pData, size_t count, float scale);
+
+// 场值 -> 预乘 alpha R8G8B8A8 的查找表，合成时每个像素只查一次；只随设置变化
+struct CompositeLut
+{
+	static constexpr uint32_t Size = 4096;
+
+	uint32_t Entries[Size];
+	uint32_t Background;
+	float    Scale;
+};
+
+// 每个输出列在场上的水平双线性采样位置，只和输出宽度、场宽度有关
+struct ColumnTaps
+{
+	const int32_t* pIndex0;
+	const int32_t* pIndex1;
+	const float*   pWeight;
+};
+
+
+namespace SoftKernels
+{
+	static float Saturate(float value)
+	{
+		// 与 HLSL 一致: NaN 饱和为 0
+		return value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f;
+	}
+
+	static const char* SimdLevelName(SimdLevel level)
+	{
+		switch (level)
+		{
+			case SimdLevel::Avx2:
+				return "AVX2";
+			case SimdLevel::Sse41:
+				return "SSE4.1";
+			default:
+				return "Scalar";
+		}
+	}
+
+	static SimdLevel DetectSimdLevel()
+	{
+#if defined(_MSC_VER)
+		int info[4] = {};
+		__cpuid(info, 0);
+		auto maxLeaf = info[0];
+
+		__cpuid(info, 1);
+		auto hasSse41   = (info[2] & (1 << 19)) != 0;
+		auto hasOsxsave = (info[2] & (1 << 27)) != 0;
+		auto hasAvx     = (info[2] & (1 << 28)) != 0;
+
+		auto hasAvx2 = false;
+		if (maxLeaf >= 7 && hasAvx && hasOsxsave && (_xgetbv(0) & 0x6) == 0x6)
+		{
+			__cpuidex(info, 7, 0);
+			hasAvx2 = (info[1] & (1 << 5)) != 0;
+		}
+#else
+		__builtin_cpu_init();
+		auto hasSse41 = __builtin_cpu_supports("sse4.1") != 0;
+		auto hasAvx2  = __builtin_cpu_supports("avx2") != 0;
+#endif
+
+		if (hasAvx2)
+			return SimdLevel::Avx2;
+		if (hasSse41)
+			return SimdLevel::Sse41;
+		return SimdLevel::Scalar;
+	}
+
+	static SimdLevel ActiveSimdLevel()
+	{
+		static const auto level = DetectSimdLevel();
+		return level;
+	}
+
+	static SplatParams HeatmapParams(const PSConstantData& data)
+	{
+		return {data.GazePoint.X, data.GazePoint.Y, data.AspectRatio, data.SizeSquared, data.Trail, Saturate(data.Decay), 0.03f * data.GainScale, data.GazePoint.X, data.GazePoint.Y};
+	}
+
+	static SplatParams BubbleParams(const PSConstantData& data)
+	{
+		return {data.GazePoint.X, data.GazePoint.Y, data.AspectRatio, data.SizeSquared, data.Trail, data.Decay, 1.7f * data.GainScale, data.GazePoint.X, data.GazePoint.Y};
+	}
+
+	// 把圆形 splat 变成从 start（上一个注视点的 uv）到当前注视点的胶囊
+	static SplatParams CapsuleParams(SplatParams params, Point start)
+	{
+		params.EndU  = params.GazeU;
+		params.EndV  = params.GazeV;
+		params.GazeU = start.X;
+		params.GazeV = start.Y;
+		return params;
+	}
+
+	static SplatParams SolidParams(const PSConstantData& data)
+	{
+		return {data.GazePoint.X, data.GazePoint.Y, data.AspectRatio, data.SizeSquared, data.Trail, data.Decay, 0.0f, data.GazePoint.X, data.GazePoint.Y};
+	}
+
+
+#pragma region FlushDenormal
+	// 0.95 这样的衰减几千帧后会把没被碰过的像素压进非规格化数，CPU 上每次乘法都慢几十倍
+	// 结果低于 FLT_MIN 时直接写 0，相当于 FTZ；写回场的值永远不是非规格化数，也就相当于 DAZ
+	// 不改 MXCSR，和线程、调用方的浮点环境无关，标量与 SIMD 结果仍逐位一致
+
+	static constexpr float DenormalThreshold = 1.17549435e-38f; // FLT_MIN
+
+	static float FlushDenormal(float value)
+	{
+		return value >= DenormalThreshold ? value : 0.0f;
+	}
+
+	SOFT_KERNEL_TARGET("sse4.1")
+	static __m128 FlushDenormalSse41(__m128 value)
+	{
+		return _mm_and_ps(value, _mm_cmpge_ps(value, _mm_set1_ps(DenormalThreshold)));
+	}
+
+	SOFT_KERNEL_TARGET("avx2")
+	static __m256 FlushDenormalAvx2(__m256 value)
+	{
+		return _mm256_and_ps(value, _mm256_cmp_ps(value, _mm256_set1_ps(DenormalThreshold), _CMP_GE_OQ));
+	}
+#pragma endregion
+
+
+#pragma region Heatmap
+	// HeatmapPixelShader.hlsl: tex * saturate(decay) + (1 - saturate(dist² / sizeSquared)) * 0.03
+	// 像素中心 uv = (x + 0.5) / width，线性采样在纹素中心正好取到原值
+
+	static void HeatmapRowScalar(float* pRow, uint32_t y, uint32_t x0, uint32_t x1, uint32_t width, uint32_t height, const SplatParams& params)
+	{
+		auto v       = (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+		auto offsetY = params.GazeV - v;
+
+		for (auto x = x0; x < x1; ++x)
+		{
+			auto u       = (static_cast<float>(x) + 0.5f) / static_cast<float>(width);
+			auto offsetX = (params.GazeU - u) * params.AspectRatio;
+
+			auto distSquared    = offsetX * offsetX + offsetY * offsetY;
+			auto normalizedDist = 1.0f - Saturate(distSquared / params.SizeSquared);
+
+			pRow[x - x0] = FlushDenormal(pRow[x - x0] * params.Decay + normalizedDist * params.Gain);
+		}
+	}
+
+	SOFT_KERNEL_TARGET("sse4.1")
+	static void HeatmapRowSse41(float* pRow, uint32_t y, uint32_t x0, uint32_t x1, uint32_t width, uint32_t height, const SplatParams& params)
+	{
+		auto v       = (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+		auto offsetY = params.GazeV - v;
+
+		const auto zero        = _mm_setzero_ps();
+		const auto one         = _mm_set1_ps(1.0f);
+		const auto half        = _mm_set1_ps(0.5f);
+		const auto fWidth      = _mm_set1_ps(static_cast<float>(width));
+		const auto gazeU       = _mm_set1_ps(params.GazeU);
+		const auto aspect      = _mm_set1_ps(params.AspectRatio);
+		const auto offsetYSq   = _mm_set1_ps(offsetY * offsetY);
+		const auto sizeSquared = _mm_set1_ps(params.SizeSquared);
+		const auto decay       = _mm_set1_ps(params.Decay);
+		const auto gain        = _mm_set1_ps(params.Gain);
+		const auto laneStep    = _mm_set1_epi32(4);
+
+		auto lanes = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(x0)), _mm_setr_epi32(0, 1, 2, 3));
+		auto x     = x0;
+
+		for (; x + 4 <= x1; x += 4)
+		{
+			auto u       = _mm_div_ps(_mm_add_ps(_mm_cvtepi32_ps(lanes), half), fWidth);
+			auto offsetX = _mm_mul_ps(_mm_sub_ps(gazeU, u), aspect);
+
+			auto distSquared    = _mm_add_ps(_mm_mul_ps(offsetX, offsetX), offsetYSq);
+			auto normalizedDist = _mm_sub_ps(one, _mm_min_ps(_mm_max_ps(_mm_div_ps(distSquared, sizeSquared), zero), one));
+
+			auto tex = _mm_loadu_ps(pRow + (x - x0));
+			_mm_storeu_ps(pRow + (x - x0), FlushDenormalSse41(_mm_add_ps(_mm_mul_ps(tex, decay), _mm_mul_ps(normalizedDist, gain))));
+
+			lanes = _mm_add_epi32(lanes, laneStep);
+		}
+
+		HeatmapRowScalar(pRow + (x - x0), y, x, x1, width, height, params);
+	}
+
+	SOFT_KERNEL_TARGET("avx2")
+	static void HeatmapRowAvx2(float* pRow, uint32_t y, uint32_t x0, uint32_t x1, uint32_t width, uint32_t height, const SplatParams& params)
+	{
+		auto v       = (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+		auto offsetY = params.GazeV - v;
+
+		const auto zero        = _mm256_setzero_ps();
+		const auto one         = _mm256_set1_ps(1.0f);
+		const auto half        = _mm256_set1_ps(0.5f);
+		const auto fWidth      = _mm256_set1_ps(static_cast<float>(width));
+		const auto gazeU       = _mm256_set1_ps(params.GazeU);
+		const auto aspect      = _mm256_set1_ps(params.AspectRatio);
+		const auto offsetYSq   = _mm256_set1_ps(offsetY * offsetY);
+		const auto sizeSquared = _mm256_set1_ps(params.SizeSquared);
+		const auto decay       = _mm256_set1_ps(params.Decay);
+		const auto gain        = _mm256_set1_ps(params.Gain);
+		const auto laneStep    = _mm256_set1_epi32(8);
+
+		auto lanes = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(x0)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		auto x     = x0;
+
+		// 不用 FMA，保证与标量版本逐位一致
+		for (; x + 8 <= x1; x += 8)
+		{
+			auto u       = _mm256_div_ps(_mm256_add_ps(_mm256_cvtepi32_ps(lanes), half), fWidth);
+			auto offsetX = _mm256_mul_ps(_mm256_sub_ps(gazeU, u), aspect);
+
+			auto distSquared    = _mm256_add_ps(_mm256_mul_ps(offsetX, offsetX), offsetYSq);
+			auto normalizedDist = _mm256_sub_ps(one, _mm256_min_ps(_mm256_max_ps(_mm256_div_ps(distSquared, sizeSquared), zero), one));
+
+			auto tex = _mm256_loadu_ps(pRow + (x - x0));
+			_mm256_storeu_ps(pRow + (x - x0), FlushDenormalAvx2(_mm256_add_ps(_mm256_mul_ps(tex, decay), _mm256_mul_ps(normalizedDist, gain))));
+
+			lanes = _mm256_add_epi32(lanes, laneStep);
+		}
+
+		HeatmapRowScalar(pRow + (x - x0), y, x, x1, width, height, params);
+	}
+#pragma endregion
+
+
+#pragma region Bubble
+	// BubblePixelShader.hlsl: 每个像素只依赖自身的旧值，可以原地更新
+	// factor = saturate(-5 * (dist² < aspect²) * (1 - trail) * saturate((dist² - sizeSquared) * 4) + decay)
+	// out    = tex * factor + (1 - saturate(dist² / sizeSquared)) * 1.7
+
+	static void BubbleRowScalar(float* pRow, uint32_t y, uint32_t x0, uint32_t x1, uint32_t width, uint32_t height, const SplatParams& params)
+	{
+		auto v        = (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+		auto offsetY  = params.GazeV - v;
+		auto aspectSq = params.AspectRatio * params.AspectRatio;
+
+		for (auto x = x0; x < x1; ++x)
+		{
+			auto u       = (static_cast<float>(x) + 0.5f) / static_cast<float>(width);
+			auto offsetX = (params.GazeU - u) * params.AspectRatio;
+
+			auto distSquared = offsetX * offsetX + offsetY * offsetY;
+
+			auto isInsideCircle = distSquared < aspectSq ? 1.0f : 0.0f;
+			isInsideCircle *= 1.0f - params.Trail;
+			isInsideCircle *= Saturate((distSquared - params.SizeSquared) * 4.0f);
+			isInsideCircle = Saturate(isInsideCircle * -5.0f + params.Decay);
+
+			auto normalizedDist = 1.0f - Saturate(distSquared / params.SizeSquared);
+
+			pRow[x - x0] = FlushDenormal(pRow[x - x0] * isInsideCircle + normalizedDist * params.Gain);
+		}
+	}
+
+	SOFT_KERNEL_TARGET("sse4.1")
+	static void BubbleRowSse41(float* pRow, uint32_t y, uint32_t x0, uint32_t x1, uint32_t width, uint32_t height, const SplatParams& params)
+	{
+		auto v       = (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+		auto offsetY = params.GazeV - v;
+
+		const auto zero        = _mm_setzero_ps();
+		const auto one         = _mm_set1_ps(1.0f);
+		const auto half        = _mm_set1_ps(0.5f);
+		const auto four        = _mm_set1_ps(4.0f);
+		const auto minusFive   = _mm_set1_ps(-5.0f);
+		const auto fWidth      = _mm_set1_ps(static_cast<float>(width));
+		const auto gazeU       = _mm_set1_ps(params.GazeU);
+		const auto aspect      = _mm_set1_ps(params.AspectRatio);
+		const auto aspectSq    = _mm_set1_ps(params.AspectRatio * params.AspectRatio);
+		const auto offsetYSq   = _mm_set1_ps(offsetY * offsetY);
+		const auto sizeSquared = _mm_set1_ps(params.SizeSquared);
+		const auto trail       = _mm_set1_ps(1.0f - params.Trail);
+		const auto decay       = _mm_set1_ps(params.Decay);
+		const auto gain        = _mm_set1_ps(params.Gain);
+		const auto laneStep    = _mm_set1_epi32(4);
+
+		auto lanes = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(x0)), _mm_setr_epi32(0, 1, 2, 3));
+		auto x     = x0;
+
+		for (; x + 4 <= x1; x += 4)
+		{
+			auto u       = _mm_div_ps(_mm_add_ps(_mm_cvtepi32_ps(lanes), half), fWidth);
+			auto offsetX = _mm_mul_ps(_mm_sub_ps(gazeU, u), aspect);
+
+			auto distSquared = _mm_add_ps(_mm_mul_ps(offsetX, offsetX), offsetYSq);
+
+			auto isInsideCircle = _mm_blendv_ps(zero, one, _mm_cmplt_ps(distSquared, aspectSq));
+			isInsideCircle      = _mm_mul_ps(isInsideCircle, trail);
+			isInsideCircle      = _mm_mul_ps(isInsideCircle, _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(distSquared, sizeSquared), four), zero), one));
+			isInsideCircle      = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(isInsideCircle, minusFive), decay), zero), one);
+
+			auto normalizedDist = _mm_sub_ps(one, _mm_min_ps(_mm_max_ps(_mm_div_ps(distSquared, sizeSquared), zero), one));
+
+			auto tex = _mm_loadu_ps(pRow + (x - x0));
+			_mm_storeu_ps(pRow + (x - x0), FlushDenormalSse41(_mm_add_ps(_mm_mul_ps(tex, isInsideCircle), _mm_mul_ps(normalizedDist, gain))));
+
+			lanes = _mm_add_epi32(lanes, laneStep);
+		}
+
+		BubbleRowScalar(pRow + (x - x0), y, x, x1, width, height, params);
+	}
+
+	SOFT_KERNEL_TARGET("avx2")
+	static void BubbleRowAvx2(float* pRow, uint32_t y, uint32_t x0, uint32_t x1, uint32_t width, uint32_t height, const SplatParams& params)
+	{
+		auto v       = (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+		auto offsetY = params.GazeV - v;
+
+		const auto zero        = _mm256_setzero_ps();
+		const auto one         = _mm256_set1_ps(1.0f);
+		const auto half        = _mm256_set1_ps(0.5f);
+		const auto four        = _mm256_set1_ps(4.0f);
+		const auto minusFive   = _mm256_set1_ps(-5.0f);
+		const auto fWidth      = _mm256_set1_ps(static_cast<float>(width));
+		const auto gazeU       = _mm256_set1_ps(params.GazeU);
+		const auto aspect      = _mm256_set1_ps(params.AspectRatio);
+		const auto aspectSq    = _mm256_set1_ps(params.AspectRatio * params.AspectRatio);
+		const auto offsetYSq   = _mm256_set1_ps(offsetY * offsetY);
+		const auto sizeSquared = _mm256_set1_ps(params.SizeSquared);
+		const auto trail       = _mm256_set1_ps(1.0f - params.Trail);
+		const auto decay       = _mm256_set1_ps(params.Decay);
+		const auto gain        = _mm256_set1_ps(params.Gain);
+		const auto laneStep    = _mm256_set1_epi32(8);
+
+		auto lanes = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(x0)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		auto x     = x0;
+
+		for (; x + 8 <= x1; x += 8)
+		{
+			auto u       = _mm256_div_ps(_mm256_add_ps(_mm256_cvtepi32_ps(lanes), half), fWidth);
+			auto offsetX = _mm256_mul_ps(_mm256_sub_ps(gazeU, u), aspect);
+
+			auto distSquared = _mm256_add_ps(_mm256_mul_ps(offsetX, offsetX), offsetYSq);
+
+			auto isInsideCircle = _mm256_blendv_ps(zero, one, _mm256_cmp_ps(distSquared, aspectSq, _CMP_LT_OQ));
+			isInsideCircle      = _mm256_mul_ps(isInsideCircle, trail);
+			isInsideCircle      = _mm256_mul_ps(isInsideCircle, _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(distSquared, sizeSquared), four), zero), one));
+			isInsideCircle      = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_mul_ps(isInsideCircle, minusFive), decay), zero), one);
+
+			auto normalizedDist = _mm256_sub_ps(one, _mm256_min_ps(_mm256_max_ps(_mm256_div_ps(distSquared, sizeSquared), zero), one));
+
+			auto tex = _mm256_loadu_ps(pRow + (x - x0));
+			_mm256_storeu_ps(pRow + (x - x0), FlushDenormalAvx2(_mm256_add_ps(_mm256_mul_ps(tex, isInsideCircle), _mm256_mul_ps(normalizedDist, gain))));
+
+			lanes = _mm256_add_epi32(lanes, laneStep);
+		}
+
+		BubbleRowScalar(pRow + (x - x0), y, x, x1, width, height, params);
+	}
+#pragma endregion
+
+
+#pragma region Solid
+	// SolidPixelShader.hlsl: tex * decay，没有注视点时 Bubble/Solid 都走这里
+
+	static void SolidRowScalar(float* pRow, uint32_t, uint32_t x0, uint32_t x1, uint32_t, uint32_t, const SplatParams& params)
+	{
+		for (auto x = x0; x < x1; ++x)
+			pRow[x - x0] = FlushDenormal(pRow[x - x0] * params.Decay);
+	}
+
+	SOFT_KERNEL_TARGET("sse4.1")
+	static void SolidRowSse41(float* pRow, uint32_t y, uint32_t x0, uint32_t x1, uint32_t width, uint32_t height, const SplatParams& params)
+	{
+		const auto decay = _mm_set1_ps(params.Decay);
+
+		auto x = x0;
+		for (; x + 4 <= x1; x += 4)
+			_mm_storeu_ps(pRow + (x - x0), FlushDenormalSse41(_mm_mul_ps(_mm_loadu_ps(pRow + (x - x0)), decay)));
+
+		SolidRowScalar(pRow + (x - x0), y, x, x1, width, height, params);
+	}
+
+	SOFT_KERNEL_TARGET("avx2")
+	static void SolidRowAvx2(float* pRow, uint32_t y, uint32_t x0, uint32_t x1, uint32_t width, uint32_t height, const SplatParams& params)
+	{
+		const auto decay = _mm256_set1_ps(params.Decay);
+
+		auto x = x0;
+		for (; x + 8 <= x1; x += 8)
+			_mm256_storeu_ps(pRow + (x - x0), FlushDenormalAvx2(_mm256_mul_ps(_mm256_loadu_ps(pRow + (x - x0)), decay)));
+
+		SolidRowScalar(pRow + (x - x0), y, x, x1, width, height, params);
+	}
+#pragma endregion
+
+
+#pragma region Capsule
+	// 把 Heatmap/Bubble 里 dist² 换成像素到线段 [Gaze, End] 的距离平方，一次覆盖两帧注视点之间扫过的区域
+	// 衰减形式不变，仍是 1 - saturate(dist² / sizeSquared)；线段退化成点时与圆形 splat 相同
+
+	struct CapsuleSegment
+	{
+		float AbX;
+		float AbY;
+		float InvLengthSq;
+	};
+
+	static CapsuleSegment MakeCapsuleSegment(const SplatParams& params)
+	{
+		auto abX      = (params.EndU - params.GazeU) * params.AspectRatio;
+		auto abY      = params.EndV - params.GazeV;
+		auto lengthSq = abX * abX + abY * abY;
+
+		return {abX, abY, lengthSq > 0.0f ? 1.0f / lengthSq : 0.0f};
+	}
+
+	template <bool IsBubble>
+	static void CapsuleRowScalar(float* pRow, uint32_t y, uint32_t x0, uint32_t x1, uint32_t width, uint32_t height, const SplatParams& params)
+	{
+		auto segment  = MakeCapsuleSegment(params);
+		auto v        = (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+		auto apY      = v - params.GazeV;
+		auto aspectSq = params.AspectRatio * params.AspectRatio;
+
+		for (auto x = x0; x < x1; ++x)
+		{
+			auto u   = (static_cast<float>(x) + 0.5f) / static_cast<float>(width);
+			auto apX = (u - params.GazeU) * params.AspectRatio;
+
+			auto t       = Saturate((apX * segment.AbX + apY * segment.AbY) * segment.InvLengthSq);
+			auto offsetX = apX - segment.AbX * t;
+			auto offsetY = apY - segment.AbY * t;
+
+			auto distSquared    = offsetX * offsetX + offsetY * offsetY;
+			auto normalizedDist = 1.0f - Saturate(distSquared / params.SizeSquared);
+
+			auto factor = params.Decay;
+
+			if (IsBubble)
+			{
+				factor = distSquared < aspectSq ? 1.0f : 0.0f;
+				factor *= 1.0f - params.Trail;
+				factor *= Saturate((distSquared - params.SizeSquared) * 4.0f);
+				factor = Saturate(factor * -5.0f + params.Decay);
+			}
+
+			pRow[x - x0] = FlushDenormal(pRow[x - x0] * factor + normalizedDist * params.Gain);
+		}
+	}
+
+	template <bool IsBubble>
+	SOFT_KERNEL_TARGET("sse4.1")
+	static void CapsuleRowSse41(float* pRow, uint32_t y, uint32_t x0, uint32_t x1, uint32_t width, uint32_t height, const SplatParams& params)
+	{
+		auto segment = MakeCapsuleSegment(params);
+		auto v       = (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+
+		const auto zero        = _mm_setzero_ps();
+		const auto one         = _mm_set1_ps(1.0f);
+		const auto half        = _mm_set1_ps(0.5f);
+		const auto four        = _mm_set1_ps(4.0f);
+		const auto minusFive   = _mm_set1_ps(-5.0f);
+		const auto fWidth      = _mm_set1_ps(static_cast<float>(width));
+		const auto gazeU       = _mm_set1_ps(params.GazeU);
+		const auto aspect      = _mm_set1_ps(params.AspectRatio);
+		const auto aspectSq    = _mm_set1_ps(params.AspectRatio * params.AspectRatio);
+		const auto apY         = _mm_set1_ps(v - params.GazeV);
+		const auto abX         = _mm_set1_ps(segment.AbX);
+		const auto abY         = _mm_set1_ps(segment.AbY);
+		const auto invLengthSq = _mm_set1_ps(segment.InvLengthSq);
+		const auto sizeSquared = _mm_set1_ps(params.SizeSquared);
+		const auto trail       = _mm_set1_ps(1.0f - params.Trail);
+		const auto decay       = _mm_set1_ps(params.Decay);
+		const auto gain        = _mm_set1_ps(params.Gain);
+		const auto laneStep    = _mm_set1_epi32(4);
+		const auto apYAbY      = _mm_mul_ps(apY, abY);
+
+		auto lanes = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(x0)), _mm_setr_epi32(0, 1, 2, 3));
+		auto x     = x0;
+
+		for (; x + 4 <= x1; x += 4)
+		{
+			auto u   = _mm_div_ps(_mm_add_ps(_mm_cvtepi32_ps(lanes), half), fWidth);
+			auto apX = _mm_mul_ps(_mm_sub_ps(u, gazeU), aspect);
+
+			auto t       = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(apX, abX), apYAbY), invLengthSq), zero), one);
+			auto offsetX = _mm_sub_ps(apX, _mm_mul_ps(abX, t));
+			auto offsetY = _mm_sub_ps(apY, _mm_mul_ps(abY, t));
+
+			auto distSquared    = _mm_add_ps(_mm_mul_ps(offsetX, offsetX), _mm_mul_ps(offsetY, offsetY));
+			auto normalizedDist = _mm_sub_ps(one, _mm_min_ps(_mm_max_ps(_mm_div_ps(distSquared, sizeSquared), zero), one));
+
+			auto factor = decay;
+
+			if (IsBubble)
+			{
+				factor = _mm_blendv_ps(zero, one, _mm_cmplt_ps(distSquared, aspectSq));
+				factor = _mm_mul_ps(factor, trail);
+				factor = _mm_mul_ps(factor, _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(distSquared, sizeSquared), four), zero), one));
+				factor = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(factor, minusFive), decay), zero), one);
+			}
+
+			auto tex = _mm_loadu_ps(pRow + (x - x0));
+			_mm_storeu_ps(pRow + (x - x0), FlushDenormalSse41(_mm_add_ps(_mm_mul_ps(tex, factor), _mm_mul_ps(normalizedDist, gain))));
+
+			lanes = _mm_add_epi32(lanes, laneStep);
+		}
+
+		CapsuleRowScalar<IsBubble>(pRow + (x - x0), y, x, x1, width, height, params);
+	}
+
+	template <bool IsBubble>
+	SOFT_KERNEL_TARGET("avx2")
+	static void CapsuleRowAvx2(float* pRow, uint32_t y, uint32_t x0, uint32_t x1, uint32_t width, uint32_t height, const SplatParams& params)
+	{
+		auto segment = MakeCapsuleSegment(params);
+		auto v       = (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+
+		const auto zero        = _mm256_setzero_ps();
+		const auto one         = _mm256_set1_ps(1.0f);
+		const auto half        = _mm256_set1_ps(0.5f);
+		const auto four        = _mm256_set1_ps(4.0f);
+		const auto minusFive   = _mm256_set1_ps(-5.0f);
+		const auto fWidth      = _mm256_set1_ps(static_cast<float>(width));
+		const auto gazeU       = _mm256_set1_ps(params.GazeU);
+		const auto aspect      = _mm256_set1_ps(params.AspectRatio);
+		const auto aspectSq    = _mm256_set1_ps(params.AspectRatio * params.AspectRatio);
+		const auto apY         = _mm256_set1_ps(v - params.GazeV);
+		const auto abX         = _mm256_set1_ps(segment.AbX);
+		const auto abY         = _mm256_set1_ps(segment.AbY);
+		const auto invLengthSq = _mm256_set1_ps(segment.InvLengthSq);
+		const auto sizeSquared = _mm256_set1_ps(params.SizeSquared);
+		const auto trail       = _mm256_set1_ps(1.0f - params.Trail);
+		const auto decay       = _mm256_set1_ps(params.Decay);
+		const auto gain        = _mm256_set1_ps(params.Gain);
+		const auto laneStep    = _mm256_set1_epi32(8);
+		const auto apYAbY      = _mm256_mul_ps(apY, abY);
+
+		auto lanes = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(x0)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		auto x     = x0;
+
+		for (; x + 8 <= x1; x += 8)
+		{
+			auto u   = _mm256_div_ps(_mm256_add_ps(_mm256_cvtepi32_ps(lanes), half), fWidth);
+			auto apX = _mm256_mul_ps(_mm256_sub_ps(u, gazeU), aspect);
+
+			auto t       = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(apX, abX), apYAbY), invLengthSq), zero), one);
+			auto offsetX = _mm256_sub_ps(apX, _mm256_mul_ps(abX, t));
+			auto offsetY = _mm256_sub_ps(apY, _mm256_mul_ps(abY, t));
+
+			auto distSquared    = _mm256_add_ps(_mm256_mul_ps(offsetX, offsetX), _mm256_mul_ps(offsetY, offsetY));
+			auto normalizedDist = _mm256_sub_ps(one, _mm256_min_ps(_mm256_max_ps(_mm256_div_ps(distSquared, sizeSquared), zero), one));
+
+			auto factor = decay;
+
+			if (IsBubble)
+			{
+				factor = _mm256_blendv_ps(zero, one, _mm256_cmp_ps(distSquared, aspectSq, _CMP_LT_OQ));
+				factor = _mm256_mul_ps(factor, trail);
+				factor = _mm256_mul_ps(factor, _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(distSquared, sizeSquared), four), zero), one));
+				factor = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_mul_ps(factor, minusFive), decay), zero), one);
+			}
+
+			auto tex = _mm256_loadu_ps(pRow + (x - x0));
+			_mm256_storeu_ps(pRow + (x - x0), FlushDenormalAvx2(_mm256_add_ps(_mm256_mul_ps(tex, factor), _mm256_mul_ps(normalizedDist, gain))));
+
+			lanes = _mm256_add_epi32(lanes, laneStep);
+		}
+
+		CapsuleRowScalar<IsBubble>(pRow + (x - x0), y, x, x1, width, height, params);
+	}
+#pragma endregion
+
+
+#pragma region ScaleMax
+	// 连续的一段 float 乘以 scale，并返回乘完后的最大值，分块场用它判断块是否还可见
+
+	static float ScaleMaxScalar(float* pData, size_t count, float scale)
+	{
+		auto maxValue = 0.0f;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			pData[i] = FlushDenormal(pData[i] * scale);
+			maxValue = pData[i] > maxValue ? pData[i] : maxValue;
+		}
+
+		return maxValue;
+	}
+
+	SOFT_KERNEL_TARGET("sse4.1")
+	static float ScaleMaxSse41(float* pData, size_t count, float scale)
+	{
+		const auto vScale = _mm_set1_ps(scale);
+
+		auto   vMax = _mm_setzero_ps();
+		size_t i    = 0;
+
+		for (; i + 4 <= count; i += 4)
+		{
+			auto value = FlushDenormalSse41(_mm_mul_ps(_mm_loadu_ps(pData + i), vScale));
+			_mm_storeu_ps(pData + i, value);
+			vMax = _mm_max_ps(value, vMax);
+		}
+
+		vMax = _mm_max_ps(vMax, _mm_movehl_ps(vMax, vMax));
+		vMax = _mm_max_ss(vMax, _mm_shuffle_ps(vMax, vMax, 0x1));
+
+		auto tailMax  = ScaleMaxScalar(pData + i, count - i, scale);
+		auto maxValue = _mm_cvtss_f32(vMax);
+
+		return tailMax > maxValue ? tailMax : maxValue;
+	}
+
+	SOFT_KERNEL_TARGET("avx2")
+	static float ScaleMaxAvx2(float* pData, size_t count, float scale)
+	{
+		const auto vScale = _mm256_set1_ps(scale);
+
+		auto   vMax = _mm256_setzero_ps();
+		size_t i    = 0;
+
+		for (; i + 8 <= count; i += 8)
+		{
+			auto value = FlushDenormalAvx2(_mm256_mul_ps(_mm256_loadu_ps(pData + i), vScale));
+			_mm256_storeu_ps(pData + i, value);
+			vMax = _mm256_max_ps(value, vMax);
+		}
+
+		auto vMax4 = _mm_max_ps(_mm256_castps256_ps128(vMax), _mm256_extractf128_ps(vMax, 1));
+		vMax4      = _mm_max_ps(vMax4, _mm_movehl_ps(vMax4, vMax4));
+		vMax4      = _mm_max_ss(vMax4, _mm_shuffle_ps(vMax4, vMax4, 0x1));
+
+		auto tailMax  = ScaleMaxScalar(pData + i, count - i, scale);
+		auto maxValue = _mm_cvtss_f32(vMax4);
+
+		return tailMax > maxValue ? tailMax : maxValue;
+	}
+#pragma endregion
+
+
+#pragma region Composite
+	// 合成 Pass: 全分辨率像素中心在场上双线性采样（线性采样器 + CLAMP），再查形状纹理，输出预乘 alpha 的 R8G8B8A8
+	// 采样之后的部分只取决于场值和设置，预先烘焙成 CompositeLut，每个像素只剩插值 + 一次查表
+
+	static constexpr float CompositeThreshold = 0.001f;
+
+	struct BilinearTap
+	{
+		uint32_t Index0;
+		uint32_t Index1;
+		float    Weight;
+	};
+
+	static BilinearTap MakeBilinearTap(uint32_t pixel, uint32_t size, uint32_t sourceSize)
+	{
+		auto coordinate = std::clamp((static_cast<float>(pixel) + 0.5f) * static_cast<float>(sourceSize) / static_cast<float>(size) - 0.5f, 0.0f, static_cast<float>(sourceSize - 1));
+		auto index      = static_cast<uint32_t>(coordinate);
+
+		return {index, std::min(index + 1, sourceSize - 1), coordinate - static_cast<float>(index)};
+	}
+
+	static float UnpackChannel(uint32_t pixel, uint32_t channel)
+	{
+		return static_cast<float>((pixel >> (channel * 8)) & 0xFF) * (1.0f / 255.0f);
+	}
+
+	// wdightTex.Sample(samp, float2(u, 0))
+	static OverlayColor SampleShape(const CompositeParams& params, float u)
+	{
+		auto coordinate = std::clamp(u * static_cast<float>(params.ShapeWidth) - 0.5f, 0.0f, static_cast<float>(params.ShapeWidth - 1));
+		auto index      = static_cast<uint32_t>(coordinate);
+		auto weight     = coordinate - static_cast<float>(index);
+
+		auto pixel0 = params.pShapePixels[index];
+		auto pixel1 = params.pShapePixels[std::min(index + 1, params.ShapeWidth - 1)];
+
+		float channels[4];
+		for (uint32_t channel = 0; channel < 4; ++channel)
+		{
+			auto value0       = UnpackChannel(pixel0, channel);
+			channels[channel] = value0 + (UnpackChannel(pixel1, channel) - value0) * weight;
+		}
+
+		return {channels[0], channels[1], channels[2], channels[3]};
+	}
+
+	static uint32_t PackUnorm(float value)
+	{
+		return static_cast<uint32_t>(Saturate(value) * 255.0f + 0.5f);
+	}
+
+	// outputColor = float4(outputColor.rgb * outputColor.a, outputColor.a)
+	static uint32_t PackPremultiplied(const OverlayColor& color)
+	{
+		return PackUnorm(color.R * color.A) | PackUnorm(color.G * color.A) << 8 | PackUnorm(color.B * color.A) << 16 | PackUnorm(color.A) << 24;
+	}
+
+	static OverlayColor BlendPixel(const CompositeParams& params, float alphaWdightIndex)
+	{
+		if (!(alphaWdightIndex > CompositeThreshold))
+			return params.BackgroundColor;
+
+		if (params.IsHeatmap)
+		{
+			auto wdight = SampleShape(params, Saturate(alphaWdightIndex));
+			wdight.A *= params.Color.A;
+			return wdight;
+		}
+
+		auto alphaWdight = Saturate(SampleShape(params, Saturate(alphaWdightIndex * 0.13f)).A);
+		auto color       = params.Color;
+		auto background  = params.BackgroundColor;
+
+		return
+		{
+			color.R * alphaWdight + (1.0f - alphaWdight) * background.R,
+			color.G * alphaWdight + (1.0f - alphaWdight) * background.G,
+			color.B * alphaWdight + (1.0f - alphaWdight) * background.B,
+			color.A * alphaWdight + (1.0f - alphaWdight) * background.A,
+		};
+	}
+
+	// 表覆盖 saturate 之前有意义的整个区间: Heatmap 为 [0, 1]，Bubble/Solid 为 [0, 1 / 0.13]，超出部分取最后一项
+	static void BuildCompositeLut(CompositeLut& lut, const CompositeParams& params)
+	{
+		auto maxValue = params.IsHeatmap ? 1.0f : 1.0f / 0.13f;
+
+		lut.Scale      = static_cast<float>(CompositeLut::Size - 1) / maxValue;
+		lut.Background = PackPremultiplied(params.BackgroundColor);
+
+		// 阈值以下的像素在合成时单独走背景色，表里对应的项按刚过阈值的值计算
+		for (uint32_t i = 0; i < CompositeLut::Size; ++i)
+			lut.Entries[i] = PackPremultiplied(BlendPixel(params, std::max(static_cast<float>(i) / lut.Scale, CompositeThreshold * 1.0001f)));
+	}
+
+	// 场值变化小于返回值时，合成结果的任一通道大约最多变化一个 8 位量化级
+	// 按查找表上每 CompositeSlopeSpan 项的最大变化估计斜率，避开表项本身舍入带来的单步跳变
+	static constexpr uint32_t CompositeSlopeSpan = 32;
+
+	static float CompositeTolerance(const CompositeLut& lut)
+	{
+		auto maxStep = 1;
+
+		for (uint32_t i = CompositeSlopeSpan; i < CompositeLut::Size; ++i)
+		{
+			for (uint32_t channel = 0; channel < 4; ++channel)
+			{
+				auto a = static_cast<int>(lut.Entries[i - CompositeSlopeSpan] >> channel * 8 & 0xFF);
+				auto b = static_cast<int>(lut.Entries[i] >> channel * 8 & 0xFF);
+
+				maxStep = std::max(maxStep, a > b ? a - b : b - a);
+			}
+		}
+
+		return static_cast<float>(CompositeSlopeSpan) / (static_cast<float>(maxStep) * lut.Scale);
+	}
+
+	// pOut[i] = lerp(pRow0[i], pRow1[i], weight)，合成前先按 y 把两行场插值成一行；返回插值后的最大值
+	static float LerpRows(float* pOut, const float* pRow0, const float* pRow1, size_t count, float weight)
+	{
+		auto maxValue = 0.0f;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			pOut[i]  = pRow0[i] + (pRow1[i] - pRow0[i]) * weight;
+			maxValue = pOut[i] > maxValue ? pOut[i] : maxValue;
+		}
+
+		return maxValue;
+	}
+
+	static uint32_t LookupComposite(float value, const CompositeLut& lut)
+	{
+		if (!(value > CompositeThreshold))
+			return lut.Background;
+
+		auto scaled = value * lut.Scale + 0.5f;
+		scaled      = scaled > 0.0f ? scaled : 0.0f;
+		scaled      = scaled < static_cast<float>(CompositeLut::Size - 1) ? scaled : static_cast<float>(CompositeLut::Size - 1);
+
+		return lut.Entries[static_cast<int32_t>(scaled)];
+	}
+
+	// pFieldRow 为已经在上下两行之间插值过的场行
+	// 瓶颈是按列取场值和查表这两次依赖的随机读，SSE4.1/AVX2 版本（包括 gather）都没有比标量快，只保留标量
+	static void CompositeRow(uint32_t* pOut, const float* pFieldRow, const ColumnTaps& taps, uint32_t x0, uint32_t x1, float fieldScale, const CompositeLut& lut)
+	{
+		for (auto x = x0; x < x1; ++x)
+		{
+			auto value0 = pFieldRow[taps.pIndex0[x]];
+			auto value  = (value0 + (pFieldRow[taps.pIndex1[x]] - value0) * taps.pWeight[x]) * fieldScale;
+
+			pOut[x] = LookupComposite(value, lut);
+		}
+	}
+#pragma endregion
+
+
+	static SplatRowKernel HeatmapRowKernel(SimdLevel level)
+	{
+		switch (level)
+		{
+			case SimdLevel::Avx2:
+				return HeatmapRowAvx2;
+			case SimdLevel::Sse41:
+				return HeatmapRowSse41;
+			default:
+				return HeatmapRowScalar;
+		}
+	}
+
+	static SplatRowKernel BubbleRowKernel(SimdLevel level)
+	{
+		switch (level)
+		{
+			case SimdLevel::Avx2:
+				return BubbleRowAvx2;
+			case SimdLevel::Sse41:
+				return BubbleRowSse41;
+			default:
+				return BubbleRowScalar;
+		}
+	}
+
+	static SplatRowKernel HeatmapCapsuleRowKernel(SimdLevel level)
+	{
+		switch (level)
+		{
+			case SimdLevel::Avx2:
+				return CapsuleRowAvx2<false>;
+			case SimdLevel::Sse41:
+				return CapsuleRowSse41<false>;
+			default:
+				return CapsuleRowScalar<false>;
+		}
+	}
+
+	static SplatRowKernel BubbleCapsuleRowKernel(SimdLevel level)
+	{
+		switch (level)
+		{
+			case SimdLevel::Avx2:
+				return CapsuleRowAvx2<true>;
+			case SimdLevel::Sse41:
+				return CapsuleRowSse41<true>;
+			default:
+				return CapsuleRowScalar<true>;
+		}
+	}
+
+	static SplatRowKernel SolidRowKernel(SimdLevel level)
+	{
+		switch (level)
+		{
+			case SimdLevel::Avx2:
+				return SolidRowAvx2;
+			case SimdLevel::Sse41:
+				return SolidRowSse41;
+			default:
+				return SolidRowScalar;
+		}
+	}
+
+	static ScaleMaxKernel ScaleMaxSpanKernel(SimdLevel level)
+	{
+		switch (level)
+		{
+			case SimdLevel::Avx2:
+				return ScaleMaxAvx2;
+			case SimdLevel::Sse41:
+				return ScaleMaxSse41;
+			default:
+				return ScaleMaxScalar;
+		}
+	}
+
+	// 对 RenderAndSwapBuffer 里会用到的那个 Pass 原地执行一次
+	static void RunPass(float* pField, uint32_t width, uint32_t height, size_t stride, SplatRowKernel kernel, const SplatParams& params)
+	{
+		for (uint32_t y = 0; y < height; ++y)
+			kernel(pField + y * stride, y, 0, width, width, height, params);
+	}
+
+	// 只在 rect 内执行，uv 仍按整张场计算
+	static void RunPass(float* pField, uint32_t width, uint32_t height, size_t stride, SplatRowKernel kernel, const SplatParams& params, const FieldRect& rect)
+	{
+		for (auto y = rect.Top; y < rect.Bottom; ++y)
+			kernel(pField + y * stride + rect.Left, y, rect.Left, rect.Right, width, height, params);
+	}
+
+	static uint32_t ClampToField(double value, uint32_t size)
+	{
+		if (!(value > 0.0))
+			return 0;
+		if (value > static_cast<double>(size))
+			return size;
+		return static_cast<uint32_t>(value);
+	}
+
+	// 1 - saturate(dist² / sizeSquared) 只在半径 sqrt(sizeSquared) 内非零，返回覆盖这个圆（胶囊时为两端圆）的像素矩形
+	// u 方向的距离乘过 aspectRatio，所以 u 方向半径要除回去；两边各多留一个像素
+	static FieldRect SplatBounds(const SplatParams& params, uint32_t width, uint32_t height)
+	{
+		auto radiusV = std::sqrt(static_cast<double>(params.SizeSquared));
+		auto radiusU = radiusV / static_cast<double>(params.AspectRatio);
+
+		if (!(radiusU < 1e6))
+			radiusU = 1e6;
+
+		return
+		{
+			ClampToField(std::floor((std::min(params.GazeU, params.EndU) - radiusU) * width - 0.5), width),
+			ClampToField(std::floor((std::min(params.GazeV, params.EndV) - radiusV) * height - 0.5), height),
+			ClampToField(std::ceil((std::max(params.GazeU, params.EndU) + radiusU) * width - 0.5) + 1.0, width),
+			ClampToField(std::ceil((std::max(params.GazeV, params.EndV) + radiusV) * height - 0.5) + 1.0, height),
+		};
+	}
+
+	// 按 D3D11 线性采样 + CLAMP 寻址把场重采样到新尺寸，与用 Solid Pass（decay = 1）画到新尺寸目标上等价
+	// 调整分辨率档位时用，不是每帧都跑，所以只有标量版本
+	static void ResampleBilinear(const float* pSource, uint32_t sourceWidth, uint32_t sourceHeight, float* pTarget, uint32_t targetWidth, uint32_t targetHeight)
+	{
+		auto scaleX = static_cast<float>(sourceWidth) / static_cast<float>(targetWidth);
+		auto scaleY = static_cast<float>(sourceHeight) / static_cast<float>(targetHeight);
+
+		for (uint32_t y = 0; y < targetHeight; ++y)
+		{
+			auto sy = std::clamp((static_cast<float>(y) + 0.5f) * scaleY - 0.5f, 0.0f, static_cast<float>(sourceHeight - 1));
+			auto y0 = static_cast<uint32_t>(sy);
+			auto y1 = std::min(y0 + 1, sourceHeight - 1);
+			auto fy = sy - static_cast<float>(y0);
+
+			auto pRow0 = pSource + static_cast<size_t>(y0) * sourceWidth;
+			auto pRow1 = pSource + static_cast<size_t>(y1) * sourceWidth;
+			auto pOut  = pTarget + static_cast<size_t>(y) * targetWidth;
+
+			for (uint32_t x = 0; x < targetWidth; ++x)
+			{
+				auto sx = std::clamp((static_cast<float>(x) + 0.5f) * scaleX - 0.5f, 0.0f, static_cast<float>(sourceWidth - 1));
+				auto x0 = static_cast<uint32_t>(sx);
+				auto x1 = std::min(x0 + 1, sourceWidth - 1);
+				auto fx = sx - static_cast<float>(x0);
+
+				auto top    = pRow0[x0] + (pRow0[x1] - pRow0[x0]) * fx;
+				auto bottom = pRow1[x0] + (pRow1[x1] - pRow1[x0]) * fx;
+
+				pOut[x] = top + (bottom - top) * fy;
+			}
+		}
+	}
+}
@@ -0,0 +1,853 @@
+﻿#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "Common.h"
+#include "FieldChangeTracker.hpp"
+#include "FixationClassifier.hpp"
+#include "Reousrce.h"
+#include "ResolutionGovernor.hpp"
+#include "SoftKernels.hpp"
+#include "Telemetry.hpp"
+#include "ThreadPool.hpp"
+#include "TobiiRenderData.hpp"
+
+
+// TobiiRender 的纯 CPU 版本，不依赖 D3D11 设备，用于无显卡环境和离线导出
+// 每个像素只依赖自身旧值，所以只需要一块场缓冲原地更新，不需要前后缓冲来回交换
+class SoftRender
+{
+private:
+	uint32_t _width  = 800;
+	uint32_t _height = 600;
+
+	uint32_t           _fieldWidth  = 0;
+	uint32_t           _fieldHeight = 0;
+	std::vector<float> _field;
+
+	PSConstantData  _constantData = {};
+	TobiiRenderData _renderData   = {};
+
+	// 眼动仪线程写入，渲染线程每帧 ConsumeGazeSamples 时取走
+	GazeRing _gazeRing;
+
+	// 多人同屏时第 2 个起的观看者，各自有采样缓冲和平滑/预测状态，热量累加在同一张场里
+	// 第 1 个观看者就是上面的 _renderData / _gazeRing，场的上界等全局状态只记在 _renderData 里
+	struct ViewerStream
+	{
+		GazeRing        Ring;
+		TobiiRenderData Data;
+	};
+
+	// 只增不减: 观看者数量减少时多出来的只停用，生产者线程手里的采样缓冲一直有效
+	// 前 _viewerCount - 1 个参与渲染
+	std::vector<std::unique_ptr<ViewerStream>> _viewers;
+	uint32_t                                   _viewerCount = 1;
+
+	SimdLevel _simdLevel = SoftKernels::ActiveSimdLevel();
+
+	// 惰性衰减: 场里存的是 真实值 / _fieldScale，每帧只把衰减乘进 _fieldScale
+	// 新的 splat 预先除以 _fieldScale 再写入，只有 _fieldScale 太小时才整场归一化一次
+	bool  _lazyDecay  = false;
+	float _fieldScale = 1.0f;
+
+	static constexpr float MinFieldScale = 5.42101086e-20f; // 2^-64
+
+	// 胶囊模式: 从上一个注视点到当前注视点画一段胶囊，注视点中断后重新开始
+	bool  _capsuleSplats = false;
+	bool  _hasLastGaze   = false;
+	Point _lastGaze      = {};
+
+	// RenderSamples 用，上一个采样的时间戳，0 表示还没有采样
+	int64_t                  _lastSampleTimestamp = 0;
+	std::vector<SplatParams> _sampleSplats;
+
+	// HeatmapFixationsOnly 时 RenderSamples 把采样分成注视，每次注视结束时只 splat 一次
+	FixationClassifier         _sampleClassifier;
+	std::vector<FixationEvent> _fixations;
+
+	uint32_t           _downsampleFactor = 4;
+	ResolutionGovernor _governor         = {};
+
+	// 设置线程池后，累积和合成都按块分给各线程；块大小让一块的数据留在 L1/L2 里
+	static constexpr uint32_t TileWidth  = 256;
+	static constexpr uint32_t TileHeight = 32;
+
+	// 合成的输出是 R8G8B8A8，块更宽一些，每行连续写 4KB
+	static constexpr uint32_t CompositeTileWidth = 1024;
+
+public:
+	static constexpr uint32_t MaxViewerCount = 16;
+
+private:
+
+	ThreadPool* _pThreadPool = nullptr;
+
+	// 合成用: UpdateSettings 时重建的查找表，以及每个输出列在场上的采样位置（随场尺寸重建）
+	CompositeLut         _compositeLut = {};
+	std::vector<int32_t> _columnIndex0;
+	std::vector<int32_t> _columnIndex1;
+	std::vector<float>   _columnWeights;
+
+	// 上次 Composite 以来哪些块有可见变化，Render 据此算出本帧需要重新合成的输出矩形
+	FieldChangeTracker     _changeTracker = {};
+	std::vector<FieldRect> _dirtyRects;
+
+	// callback(const FieldRect& tile)，rect 按 tileWidth x tileHeight 切块，有线程池时并行执行
+	template <typename Callback>
+	void ForEachTile(const FieldRect& rect, uint32_t tileWidth, uint32_t tileHeight, Callback&& callback)
+	{
+		if (rect.IsEmpty())
+			return;
+
+		auto tilesX = (rect.Right - rect.Left + tileWidth - 1) / tileWidth;
+		auto tilesY = (rect.Bottom - rect.Top + tileHeight - 1) / tileHeight;
+
+		auto runTile = [&](uint32_t tileIndex)
+		{
+			auto left = rect.Left + tileIndex % tilesX * tileWidth;
+			auto top  = rect.Top + tileIndex / tilesX * tileHeight;
+
+			callback(FieldRect{left, top, std::min(left + tileWidth, rect.Right), std::min(top + tileHeight, rect.Bottom)});
+		};
+
+		if (_pThreadPool == nullptr)
+		{
+			for (uint32_t i = 0; i < tilesX * tilesY; ++i)
+				runTile(i);
+			return;
+		}
+
+		_pThreadPool->ParallelFor(tilesX * tilesY, runTile);
+	}
+
+	void RunFieldPass(SplatRowKernel kernel, const SplatParams& params, const FieldRect& rect)
+	{
+		ForEachTile(rect, TileWidth, TileHeight, [&](const FieldRect& tile)
+		{
+			SoftKernels::RunPass(_field.data(), _fieldWidth, _fieldHeight, _fieldWidth, kernel, params, tile);
+		});
+	}
+
+	void RunFieldPass(SplatRowKernel kernel, const SplatParams& params)
+	{
+		RunFieldPass(kernel, params, {0, 0, _fieldWidth, _fieldHeight});
+	}
+
+	// 与 TobiiRender::CreateShapeResource 选用同一张形状纹理
+	const uint32_t* ShapePixels() const
+	{
+		switch (_renderData.ShapeType)
+		{
+			case Solid:
+				return Resource::SolidPixelsBytes;
+
+			case Heatmap:
+				return Resource::HeatmapPixelsBytes;
+
+			default:
+				return Resource::BubblePixelsBytes;
+		}
+	}
+
+	void CreateField()
+	{
+		_fieldWidth  = std::max(_width / _downsampleFactor, 1u);
+		_fieldHeight = std::max(_height / _downsampleFactor, 1u);
+
+		_field.assign(static_cast<size_t>(_fieldWidth) * _fieldHeight, 0.0f);
+		_fieldScale = 1.0f;
+
+		_changeTracker.Reset(_fieldWidth, _fieldHeight, _renderData.FieldPeak);
+
+		_columnIndex0.resize(_width);
+		_columnIndex1.resize(_width);
+		_columnWeights.resize(_width);
+
+		for (uint32_t x = 0; x < _width; ++x)
+		{
+			auto tap = SoftKernels::MakeBilinearTap(x, _width, _fieldWidth);
+
+			_columnIndex0[x]  = static_cast<int32_t>(tap.Index0);
+			_columnIndex1[x]  = static_cast<int32_t>(tap.Index1);
+			_columnWeights[x] = tap.Weight;
+		}
+	}
+
+	void RebuildCompositeLut()
+	{
+		PSConstantData data = {};
+		_renderData.FillConstantData(data, static_cast<float>(_width), static_cast<float>(_height));
+
+		CompositeParams params = {};
+		params.pShapePixels    = ShapePixels();
+		params.ShapeWidth      = sizeof(Resource::SolidPixelsBytes) / sizeof(uint32_t);
+		params.Color           = data.Color;
+		params.BackgroundColor = data.BackgroundColor;
+		params.IsHeatmap       = _renderData.ShapeType == Heatmap;
+
+		SoftKernels::BuildCompositeLut(_compositeLut, params);
+		_changeTracker.SetCompositeLut(_compositeLut);
+	}
+
+	void ClearField()
+	{
+		std::fill(_field.begin(), _field.end(), 0.0f);
+		_fieldScale = 1.0f;
+
+		_changeTracker.TrackClear();
+	}
+
+	// Solid Pass，惰性模式下只更新 _fieldScale
+	void DecayField(float decay)
+	{
+		_changeTracker.TrackDecay(decay);
+
+		if (!_lazyDecay)
+		{
+			SplatParams params = {};
+			params.Decay       = decay;
+
+			RunFieldPass(SoftKernels::SolidRowKernel(_simdLevel), params);
+			return;
+		}
+
+		_fieldScale *= decay;
+
+		if (_fieldScale < MinFieldScale)
+			Resolve();
+	}
+
+	// 只在包围盒内叠加 Heatmap splat，衰减已经由 DecayField 处理
+	void SplatHeatmap(SplatParams params)
+	{
+		params.Decay = 1.0f;
+		_changeTracker.TrackSplat(params, false);
+
+		params.Gain /= _fieldScale;
+
+		auto rect = SoftKernels::SplatBounds(params, _fieldWidth, _fieldHeight);
+		RunFieldPass(SplatKernel(Heatmap, params), params, rect);
+	}
+
+	// 胶囊模式下接上上一个注视点，并记住当前注视点
+	SplatParams LinkToLastGaze(SplatParams params)
+	{
+		Point gaze = {params.GazeU, params.GazeV};
+
+		if (_capsuleSplats && _hasLastGaze)
+			params = SoftKernels::CapsuleParams(params, _lastGaze);
+
+		_lastGaze    = gaze;
+		_hasLastGaze = true;
+
+		return params;
+	}
+
+	SplatRowKernel SplatKernel(ShapeTypes shapeType, const SplatParams& params) const
+	{
+		auto isCapsule = params.GazeU != params.EndU || params.GazeV != params.EndV;
+
+		if (shapeType == Heatmap)
+			return isCapsule ? SoftKernels::HeatmapCapsuleRowKernel(_simdLevel) : SoftKernels::HeatmapRowKernel(_simdLevel);
+
+		return isCapsule ? SoftKernels::BubbleCapsuleRowKernel(_simdLevel) : SoftKernels::BubbleRowKernel(_simdLevel);
+	}
+
+	void RefreshConstantData()
+	{
+		_renderData.FillConstantData(_constantData, static_cast<float>(_width), static_cast<float>(_height));
+		_renderData.DataIsDirty = false;
+	}
+
+	// 把本帧耗时交给 governor，需要换档时重采样场
+	void UpdateGovernor(std::chrono::steady_clock::time_point start)
+	{
+		auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (_governor.Update(seconds))
+			SetDownsampleFactor(_governor.GetDownsampleFactor());
+	}
+
+	// 返回是否有需要合成的矩形
+	bool UpdateDirtyRects()
+	{
+		_dirtyRects.clear();
+
+		if (_changeTracker.HasChanges())
+			_changeTracker.CollectDirtyRects(_width, _height, _dirtyRects);
+
+		return !_dirtyRects.empty();
+	}
+
+	// 场的上界低于可见阈值时整场清零，之后没有新注视点就不再执行任何 Pass
+	void CheckConvergence()
+	{
+		if (!_renderData.IsFieldConverged() || _renderData.FieldPeak == 0.0f)
+			return;
+
+		ClearField();
+		_renderData.FieldPeak = 0.0f;
+	}
+
+	void RenderField()
+	{
+		if (_viewerCount > 1)
+		{
+			RenderViewersField();
+			return;
+		}
+
+		if (_renderData.DataIsDirty || _renderData.HasGaze())
+			RefreshConstantData();
+
+		if (!_renderData.HasGaze())
+		{
+			_hasLastGaze = false;
+
+			if (_renderData.FieldPeak == 0.0f)
+				return;
+
+			DecayField(_constantData.Decay);
+			_renderData.TrackFieldPeak(_constantData.Decay, 0.0f);
+			CheckConvergence();
+			return;
+		}
+
+		if (_renderData.ShapeType == Heatmap)
+		{
+			auto params = LinkToLastGaze(SoftKernels::HeatmapParams(_constantData));
+
+			_renderData.TrackFieldPeak(params.Decay, params.Gain);
+
+			if (_lazyDecay)
+			{
+				DecayField(params.Decay);
+				SplatHeatmap(params);
+			}
+			else
+			{
+				_changeTracker.TrackSplat(params, false);
+				RunFieldPass(SplatKernel(Heatmap, params), params);
+			}
+			return;
+		}
+
+		// Bubble 的衰减系数随位置变化，只能整场执行；进入整场 Pass 前先把缩放折回场里
+		auto params = LinkToLastGaze(SoftKernels::BubbleParams(_constantData));
+
+		_renderData.TrackFieldPeak(params.Decay, params.Gain);
+		_changeTracker.TrackSplat(params, true);
+
+		Resolve();
+		RunFieldPass(SplatKernel(Bubble, params), params);
+	}
+
+	// 每个采样按它占用的时长分摊一帧的热量
+	void CollectSampleSplats(const GazeSample* pSamples, size_t count, int64_t frameTimestamp, double frameDurationUs, const SplatParams& baseParams, bool isHeatmap)
+	{
+		auto validCount = std::count_if(pSamples, pSamples + count, [](const GazeSample& sample) { return sample.IsValid; });
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const auto& sample = pSamples[i];
+
+			auto duration = _lastSampleTimestamp != 0 ? static_cast<double>(sample.Timestamp - _lastSampleTimestamp) : frameDurationUs / std::max<ptrdiff_t>(validCount, 1);
+
+			_lastSampleTimestamp = sample.Timestamp;
+
+			if (!sample.IsValid)
+			{
+				_hasLastGaze = false;
+				continue;
+			}
+
+			auto share = std::clamp(duration / frameDurationUs, 0.0, 1.0);
+			auto age   = std::max(static_cast<double>(frameTimestamp - sample.Timestamp) / frameDurationUs, 0.0);
+
+			auto params  = baseParams;
+			params.GazeU = params.EndU = sample.Position.X / static_cast<float>(_width);
+			params.GazeV = params.EndV = sample.Position.Y / static_cast<float>(_height);
+			params       = LinkToLastGaze(params);
+
+			if (isHeatmap)
+			{
+				params.Gain = static_cast<float>(baseParams.Gain * share * std::pow(baseParams.Decay, age));
+			}
+			else
+			{
+				params.Gain  = static_cast<float>(baseParams.Gain * share);
+				params.Decay = static_cast<float>(std::pow(baseParams.Decay, share));
+			}
+
+			_sampleSplats.push_back(params);
+		}
+	}
+
+	// 注视在中心 splat 一次，热量等于逐帧 splat 整个注视时长的总和，再补上注视结束到 frameTimestamp 的衰减
+	void CollectFixationSplats(const GazeSample* pSamples, size_t count, int64_t frameTimestamp, double frameDurationUs, const SplatParams& baseParams)
+	{
+		_fixations.clear();
+
+		for (size_t i = 0; i < count; ++i)
+			_sampleClassifier.AddSample(pSamples[i], [this](const FixationEvent& fixation) { _fixations.push_back(fixation); });
+
+		if (count > 0)
+			_lastSampleTimestamp = pSamples[count - 1].Timestamp;
+
+		_hasLastGaze = false;
+
+		for (const auto& fixation : _fixations)
+		{
+			auto age = std::max(static_cast<double>(frameTimestamp - fixation.Start - fixation.Duration) / frameDurationUs, 0.0);
+
+			auto params  = baseParams;
+			params.GazeU = params.EndU = fixation.Centroid.X / static_cast<float>(_width);
+			params.GazeV = params.EndV = fixation.Centroid.Y / static_cast<float>(_height);
+			params.Gain  = static_cast<float>(baseParams.Gain * (fixation.Duration / frameDurationUs) * std::pow(baseParams.Decay, age));
+
+			_sampleSplats.push_back(params);
+		}
+	}
+
+	void RenderSamplesField(const GazeSample* pSamples, size_t count, int64_t frameTimestamp, double frameDuration)
+	{
+		RefreshConstantData();
+
+		auto frameDurationUs = frameDuration * 1e6;
+		auto isHeatmap       = _renderData.ShapeType == Heatmap;
+		auto baseParams      = isHeatmap ? SoftKernels::HeatmapParams(_constantData) : SoftKernels::BubbleParams(_constantData);
+
+		_sampleSplats.clear();
+
+		if (isHeatmap && _renderData.HeatmapFixationsOnly)
+			CollectFixationSplats(pSamples, count, frameTimestamp, frameDurationUs, baseParams);
+		else
+			CollectSampleSplats(pSamples, count, frameTimestamp, frameDurationUs, baseParams, isHeatmap);
+
+		ApplySampleSplats(baseParams, isHeatmap);
+	}
+
+	// 每个观看者当前的注视点各一个 splat，热量与单人时相同
+	// Bubble 的衰减是逐个 splat 乘上去的，每个只衰减 decay^(1/n)，一帧合起来仍是 decay
+	void RenderViewersField()
+	{
+		RefreshConstantData();
+
+		auto isHeatmap  = _renderData.ShapeType == Heatmap;
+		auto baseParams = isHeatmap ? SoftKernels::HeatmapParams(_constantData) : SoftKernels::BubbleParams(_constantData);
+
+		_sampleSplats.clear();
+
+		auto collect = [&](const TobiiRenderData& data)
+		{
+			if (!data.HasGaze())
+				return;
+
+			auto gaze = data.CurrentGaze();
+
+			auto params  = baseParams;
+			params.GazeU = params.EndU = gaze.X / static_cast<float>(_width);
+			params.GazeV = params.EndV = gaze.Y / static_cast<float>(_height);
+
+			_sampleSplats.push_back(params);
+		};
+
+		collect(_renderData);
+
+		for (uint32_t i = 0; i + 1 < _viewerCount; ++i)
+			collect(_viewers[i]->Data);
+
+		if (!isHeatmap)
+		{
+			auto decay = std::pow(baseParams.Decay, 1.0f / static_cast<float>(std::max<size_t>(_sampleSplats.size(), 1)));
+
+			for (auto& params : _sampleSplats)
+				params.Decay = decay;
+		}
+
+		// 多人时胶囊无从接起，每帧都是独立的圆
+		_hasLastGaze = false;
+
+		ApplySampleSplats(baseParams, isHeatmap);
+	}
+
+	// 把 _sampleSplats 作用到场上，整场只读写一遍，没有 splat 时只衰减
+	void ApplySampleSplats(const SplatParams& baseParams, bool isHeatmap)
+	{
+		if (_sampleSplats.empty())
+		{
+			if (_renderData.FieldPeak == 0.0f)
+				return;
+
+			DecayField(_constantData.Decay);
+			_renderData.TrackFieldPeak(_constantData.Decay, 0.0f);
+			CheckConvergence();
+			return;
+		}
+
+		// 逐个采样依次作用时，上界为 peak * Πdecay + Σgain
+		auto decay = isHeatmap ? baseParams.Decay : 1.0f;
+		auto gain  = 0.0f;
+
+		for (const auto& params : _sampleSplats)
+		{
+			decay *= isHeatmap ? 1.0f : params.Decay;
+			gain += params.Gain;
+		}
+
+		_renderData.TrackFieldPeak(decay, gain);
+
+		if (isHeatmap)
+		{
+			DecayField(baseParams.Decay);
+
+			for (const auto& params : _sampleSplats)
+				SplatHeatmap(params);
+			return;
+		}
+
+		for (const auto& params : _sampleSplats)
+			_changeTracker.TrackSplat(params, true);
+
+		Resolve();
+
+		ForEachTile({0, 0, _fieldWidth, _fieldHeight}, TileWidth, TileHeight, [&](const FieldRect& tile)
+		{
+			for (auto y = tile.Top; y < tile.Bottom; ++y)
+			{
+				auto pRow = _field.data() + static_cast<size_t>(y) * _fieldWidth + tile.Left;
+
+				for (const auto& params : _sampleSplats)
+					SplatKernel(Bubble, params)(pRow, y, tile.Left, tile.Right, _fieldWidth, _fieldHeight, params);
+			}
+		});
+	}
+
+public:
+	SoftRender(uint32_t width, uint32_t height) : _width(width),
+	                                              _height(height)
+	{
+		CreateField();
+		RebuildCompositeLut();
+		UpdateDirtyRects();
+	}
+
+	// 返回 true 表示上次 Composite 之后画面有超过一个 8 位量化级的变化，变化的区域见 GetDirtyRects；false 时可以跳过 Composite 和 Present
+	bool Render()
+	{
+		if (!_renderData.Enable)
+			return UpdateDirtyRects();
+
+		StageTimer timer(TelemetryStages::Accumulate);
+
+		auto start = std::chrono::steady_clock::now();
+
+		RenderField();
+		UpdateGovernor(start);
+
+		return UpdateDirtyRects();
+	}
+
+	// 一帧内一次性处理多个带时间戳的采样，用于高采样率眼动仪，不经过 PushGazePoint 的平滑
+	// 每个采样按它占用的时长分摊一帧的热量，并按距 frameTimestamp 的时间补上帧内衰减
+	// 返回值与 Render 相同
+	// Heatmap: 整场只衰减一次（惰性模式下不碰场），之后每个采样只写自己的包围盒
+	// Bubble : 逐行把所有采样依次作用在同一行上，整场只读写一遍
+	// HeatmapFixationsOnly 时只有本帧结束的注视各 splat 一次，热量按注视时长计算
+	bool RenderSamples(const GazeSample* pSamples, size_t count, int64_t frameTimestamp, double frameDuration)
+	{
+		if (!_renderData.Enable)
+			return UpdateDirtyRects();
+
+		StageTimer timer(TelemetryStages::Accumulate);
+
+		auto start = std::chrono::steady_clock::now();
+
+		RenderSamplesField(pSamples, count, frameTimestamp, frameDuration);
+		UpdateGovernor(start);
+
+		return UpdateDirtyRects();
+	}
+
+	// TobiiRender::Render 里合成 Pass 的 CPU 版本，输出 _width x _height 的预乘 alpha R8G8B8A8，stride 以像素为单位
+	// 双线性上采样后每个像素查一次 CompositeLut，与 Shader 的差别只在查找表的量化（每通道不超过 1/255 左右）
+	// 只重写上一次 Render 给出的脏矩形，pTarget 里需要保留上次 Composite 的结果
+	void Composite(uint32_t* pTarget, size_t stride)
+	{
+		StageTimer timer(TelemetryStages::Blend);
+
+		for (const auto& rect : _dirtyRects)
+			CompositeRect(pTarget, stride, rect);
+
+		_changeTracker.MarkClean();
+	}
+
+	// 合成输出上的一个矩形，不影响变化记录
+	void CompositeRect(uint32_t* pTarget, size_t stride, const FieldRect& rect)
+	{
+		if (!_renderData.Enable)
+		{
+			for (auto y = rect.Top; y < rect.Bottom; ++y)
+				std::fill(pTarget + y * stride + rect.Left, pTarget + y * stride + rect.Right, 0u);
+			return;
+		}
+
+		auto taps = ColumnTaps{_columnIndex0.data(), _columnIndex1.data(), _columnWeights.data()};
+
+		ForEachTile(rect, CompositeTileWidth, TileHeight, [&](const FieldRect& tile)
+		{
+			// 每一行先把上下两行场插值成一行，只插值这个块用得到的列；整行都不可见时直接填背景色
+			static thread_local std::vector<float> s_fieldRow;
+			s_fieldRow.resize(_fieldWidth);
+
+			auto first = static_cast<uint32_t>(_columnIndex0[tile.Left]);
+			auto last  = static_cast<uint32_t>(_columnIndex1[tile.Right - 1]);
+
+			for (auto y = tile.Top; y < tile.Bottom; ++y)
+			{
+				auto tap   = SoftKernels::MakeBilinearTap(y, _height, _fieldHeight);
+				auto pRow0 = _field.data() + static_cast<size_t>(tap.Index0) * _fieldWidth;
+				auto pRow1 = _field.data() + static_cast<size_t>(tap.Index1) * _fieldWidth;
+
+				auto maxValue = SoftKernels::LerpRows(s_fieldRow.data() + first, pRow0 + first, pRow1 + first, last - first + 1, tap.Weight);
+
+				if (maxValue * _fieldScale > SoftKernels::CompositeThreshold)
+					SoftKernels::CompositeRow(pTarget + y * stride, s_fieldRow.data(), taps, tile.Left, tile.Right, _fieldScale, _compositeLut);
+				else
+					std::fill(pTarget + y * stride + tile.Left, pTarget + y * stride + tile.Right, _compositeLut.Background);
+			}
+		});
+	}
+
+	// 下一次 Composite 重画整个输出，例如换了输出缓冲之后
+	void Invalidate()
+	{
+		_changeTracker.MarkAllDirty();
+		UpdateDirtyRects();
+	}
+
+	bool Resize(uint32_t width, uint32_t height)
+	{
+		if (_width == width && _height == height)
+			return true;
+
+		_width  = width;
+		_height = height;
+
+		_renderData.ClearGaze();
+		_renderData.FieldPeak = 0.0f;
+
+		for (auto& viewer : _viewers)
+			viewer->Data.ClearGaze();
+
+		CreateField();
+		UpdateDirtyRects();
+		return true;
+	}
+
+	void UpdateSettings(const TobiiRenderSettings& settings)
+	{
+		if (_renderData.ApplySettings(settings))
+			ClearField();
+
+		for (auto& viewer : _viewers)
+			viewer->Data.ApplySettings(settings);
+
+		if (_sampleClassifier.GetParams().Mode != _renderData.Classifier.GetParams().Mode)
+			_sampleClassifier.SetParams(_renderData.Classifier.GetParams());
+
+		RebuildCompositeLut();
+		_changeTracker.MarkAllDirty();
+	}
+
+	void PushGazePoint(bool isActive, Point gazePoint)
+	{
+		StageTimer timer(TelemetryStages::GazeUpdate);
+		_renderData.PushGazePoint(isActive, gazePoint);
+	}
+
+	// 每帧 Render 前在渲染线程调用一次，代替 PushGazePoint；frameTimestamp 为本帧开始的时间（微秒）
+	void ConsumeGazeSamples(int64_t frameTimestamp)
+	{
+		StageTimer timer(TelemetryStages::GazeUpdate);
+		_renderData.ConsumeGazeSamples(_gazeRing, frameTimestamp);
+
+		for (uint32_t i = 0; i + 1 < _viewerCount; ++i)
+			_viewers[i]->Data.ConsumeGazeSamples(_viewers[i]->Ring, frameTimestamp);
+	}
+
+	// 不渲染的节拍调用: 取走全部采样交给平滑和预测，不推进注视点；返回上一帧之后是否来过采样，latest 为其中最新的一个
+	bool DrainGazeSamples(GazeSample& latest)
+	{
+		StageTimer timer(TelemetryStages::GazeUpdate);
+		_renderData.DrainGazeSamples(_gazeRing);
+
+		for (uint32_t i = 0; i + 1 < _viewerCount; ++i)
+			_viewers[i]->Data.DrainGazeSamples(_viewers[i]->Ring);
+
+		latest = _renderData.PendingSample;
+		return _renderData.HasPendingSample;
+	}
+
+	// 生产者一端，可以交给眼动仪的回调线程，Timestamp 单位为微秒
+	GazeRing& GetGazeRing() { return _gazeRing; }
+
+	// 第 viewer 个观看者的采样缓冲，每个观看者一个生产者线程；viewer 不小于 GetViewerCount() 时返回 nullptr
+	// 之后 SetViewerCount 调小也不会释放，停用期间推入的采样在重新启用时丢掉
+	GazeRing* GetGazeRing(uint32_t viewer)
+	{
+		if (viewer >= _viewerCount)
+		{
+			std::cerr << "Gaze Ring For Viewer " << viewer << " Out Of Range, Viewer Count: " << _viewerCount << std::endl;
+			return nullptr;
+		}
+
+		return viewer == 0 ? &_gazeRing : &_viewers[viewer - 1]->Ring;
+	}
+
+	// 同屏观看者的数量（1 到 MaxViewerCount），所有人的热量每帧在一遍 Pass 里累加进同一张场，在渲染线程调用
+	// 多人时每帧按各自当前的注视点 splat，不走胶囊；新增的观看者沿用当前设置
+	void SetViewerCount(uint32_t count)
+	{
+		count = std::clamp(count, 1u, MaxViewerCount);
+
+		while (_viewers.size() + 1 < count)
+			_viewers.emplace_back(std::make_unique<ViewerStream>());
+
+		for (auto i = _viewerCount; i < count; ++i)
+		{
+			auto& viewer = *_viewers[i - 1];
+
+			// 复制设置，平滑、预测和分类的状态从头开始
+			viewer.Ring.PopAll([](const GazeSample&) {});
+			viewer.Data = _renderData;
+			viewer.Data.ClearGaze();
+			viewer.Data.Predictor.Reset();
+			viewer.Data.Smoother.Reset();
+			viewer.Data.Classifier.Reset();
+		}
+
+		_viewerCount = count;
+	}
+
+	uint32_t GetViewerCount() const { return _viewerCount; }
+
+	// viewer 为 0 时等同于不带参数的 PushGazePoint
+	bool PushGazePoint(uint32_t viewer, bool isActive, Point gazePoint)
+	{
+		if (viewer >= _viewerCount)
+		{
+			std::cerr << "Gaze Point For Viewer " << viewer << " Out Of Range, Viewer Count: " << _viewerCount << std::endl;
+			return false;
+		}
+
+		if (viewer == 0)
+			_renderData.PushGazePoint(isActive, gazePoint);
+		else
+			_viewers[viewer - 1]->Data.PushGazePoint(isActive, gazePoint);
+
+		return true;
+	}
+
+	// 任意一个观看者有注视点
+	bool HasGaze() const
+	{
+		return _renderData.HasGaze() || std::any_of(_viewers.begin(), _viewers.begin() + (_viewerCount - 1), [](const std::unique_ptr<ViewerStream>& viewer) { return viewer->Data.HasGaze(); });
+	}
+
+	void AdvanceFrame(int64_t timestamp)
+	{
+		_renderData.AdvanceFrame(timestamp);
+	}
+
+	// 把 _fieldScale 乘回场里，之后 GetField() 返回的就是真实值
+	void Resolve()
+	{
+		if (_fieldScale == 1.0f)
+			return;
+
+		SplatParams params = {};
+		params.Decay       = _fieldScale;
+
+		RunFieldPass(SoftKernels::SolidRowKernel(_simdLevel), params);
+		_fieldScale = 1.0f;
+	}
+
+	void SetSimdLevel(SimdLevel level) { _simdLevel = std::min(level, SoftKernels::ActiveSimdLevel()); }
+
+	// 打开后每帧的 splat 是上一个注视点到当前注视点的胶囊，高速扫视时轨迹连续
+	void SetCapsuleSplats(bool enable)
+	{
+		_capsuleSplats = enable;
+		_hasLastGaze   = false;
+	}
+
+	// 切换降采样倍数，按双线性把现有的场重采样过去，热量不会丢
+	void SetDownsampleFactor(uint32_t factor)
+	{
+		if (factor == 0 || factor == _downsampleFactor)
+			return;
+
+		auto sourceWidth  = _fieldWidth;
+		auto sourceHeight = _fieldHeight;
+		auto source       = std::move(_field);
+		auto fieldScale   = _fieldScale;
+
+		_downsampleFactor = factor;
+		CreateField();
+
+		// 重采样是线性的，惰性衰减的缩放原样保留
+		SoftKernels::ResampleBilinear(source.data(), sourceWidth, sourceHeight, _field.data(), _fieldWidth, _fieldHeight);
+		_fieldScale = fieldScale;
+	}
+
+	// 每帧 Render 耗时的预算（秒），超出时自动降低场的分辨率，0 表示固定倍数
+	void SetFrameBudget(double seconds)
+	{
+		_governor.SetDownsampleFactor(_downsampleFactor);
+		_governor.SetBudget(seconds);
+	}
+
+	// 传入 nullptr 回到单线程，线程池由调用方持有，生命周期要长于 SoftRender 的使用
+	void SetThreadPool(ThreadPool* pThreadPool) { _pThreadPool = pThreadPool; }
+
+	void SetLazyDecay(bool enable)
+	{
+		if (!enable)
+			Resolve();
+
+		_lazyDecay = enable;
+	}
+
+
+	// 整张场都已低于可见阈值（CPU 上此时场已精确为 0），没有新注视点时可以停止渲染
+	bool IsFieldConverged() const { return _renderData.IsFieldConverged(); }
+
+	// 与 TobiiRender::IsIdle 相同: 没有注视点且场已收敛，本帧 Render 不会改变画面
+	bool IsIdle() const { return !HasGaze() && _renderData.IsFieldConverged(); }
+
+
+	// 惰性衰减模式下为 真实值 / GetFieldScale()
+	const float*           GetField() const { return _field.data(); }
+	float                  GetFieldScale() const { return _fieldScale; }
+	uint32_t               GetFieldWidth() const { return _fieldWidth; }
+	uint32_t               GetFieldHeight() const { return _fieldHeight; }
+	uint32_t               GetDownsampleFactor() const { return _downsampleFactor; }
+	const PSConstantData&  GetConstantData() const { return _constantData; }
+	const TobiiRenderData& GetRenderData() const { return _renderData; }
+
+	const ResolutionGovernor& GetGovernor() const { return _governor; }
+	const FieldChangeTracker& GetChangeTracker() const { return _changeTracker; }
+
+	// 上次调用以来场的活跃程度（量化级），见 FieldChangeTracker::TakeActivity
+	float TakeFieldActivity() { return _changeTracker.TakeActivity(); }
+
+	// 上一次 Render 之后需要重新合成的输出矩形（输出像素坐标，Right/Bottom 不包含）
+	const std::vector<FieldRect>& GetDirtyRects() const { return _dirtyRects; }
+};
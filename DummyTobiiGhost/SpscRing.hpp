@@ -0,0 +1,105 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "Common.h"
+
+
+// 单生产者单消费者的无锁环形缓冲: 眼动仪回调线程写入，渲染线程每帧取走，不加锁也不分配内存
+// 读写下标各占一个缓存行，并各自缓存一份对方的下标，只有看起来满/空时才去读对方的原子变量
+template <typename T, uint32_t Capacity>
+class SpscRing
+{
+	static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	static constexpr size_t CacheLineSize = 64;
+
+private:
+	static constexpr uint32_t Mask = Capacity - 1;
+
+	// 生产者独占
+	alignas(CacheLineSize) std::atomic<uint32_t> _writeIndex{0};
+	uint32_t              _cachedReadIndex = 0;
+	std::atomic<uint64_t> _droppedCount{0};
+
+	// 消费者独占
+	alignas(CacheLineSize) std::atomic<uint32_t> _readIndex{0};
+	uint32_t _cachedWriteIndex = 0;
+
+	alignas(CacheLineSize) T _items[Capacity];
+
+public:
+	SpscRing() = default;
+
+	SpscRing(const SpscRing&)            = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	// 生产者线程调用；满了返回 false 并计入丢弃数，不覆盖消费者还没取走的数据
+	bool TryPush(const T& item)
+	{
+		auto write = _writeIndex.load(std::memory_order_relaxed);
+
+		if (write - _cachedReadIndex == Capacity)
+		{
+			_cachedReadIndex = _readIndex.load(std::memory_order_acquire);
+
+			if (write - _cachedReadIndex == Capacity)
+			{
+				_droppedCount.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+		}
+
+		_items[write & Mask] = item;
+		_writeIndex.store(write + 1, std::memory_order_release);
+		return true;
+	}
+
+	// 消费者线程调用
+	bool TryPop(T& item)
+	{
+		auto read = _readIndex.load(std::memory_order_relaxed);
+
+		if (read == _cachedWriteIndex)
+		{
+			_cachedWriteIndex = _writeIndex.load(std::memory_order_acquire);
+
+			if (read == _cachedWriteIndex)
+				return false;
+		}
+
+		item = _items[read & Mask];
+		_readIndex.store(read + 1, std::memory_order_release);
+		return true;
+	}
+
+	// 消费者线程调用，按顺序对当前所有数据调用 callback(const T&)，读下标只更新一次；返回取走的个数
+	template <typename Callback>
+	uint32_t PopAll(Callback&& callback)
+	{
+		auto read = _readIndex.load(std::memory_order_relaxed);
+		_cachedWriteIndex = _writeIndex.load(std::memory_order_acquire);
+
+		for (auto i = read; i != _cachedWriteIndex; ++i)
+			callback(_items[i & Mask]);
+
+		_readIndex.store(_cachedWriteIndex, std::memory_order_release);
+		return _cachedWriteIndex - read;
+	}
+
+	// 任意线程调用，只是一个瞬时的近似值
+	uint32_t Size() const
+	{
+		return _writeIndex.load(std::memory_order_acquire) - _readIndex.load(std::memory_order_acquire);
+	}
+
+	uint64_t GetDroppedCount() const { return _droppedCount.load(std::memory_order_relaxed); }
+
+	static constexpr uint32_t GetCapacity() { return Capacity; }
+};
+
+
+// 1 kHz 的眼动仪下可以缓存约 1 秒，渲染线程每帧都会取空
+using GazeRing = SpscRing<GazeSample, 1024>;
@@ -0,0 +1,336 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+// 一帧里按顺序经过的阶段，Gpu* 来自时间戳查询，比 CPU 上对应的阶段晚几帧记录
+enum class TelemetryStages : uint32_t
+{
+	GazePush,       // 采样线程: 推进环形缓冲、统计和监听者（录制）
+	GazeUpdate,     // 渲染线程: ConsumeGazeSamples / PushGazePoint，滤波、预测和插值
+	ConstantBuffer, // Map / memcpy / Unmap 常量缓冲
+	Accumulate,     // RenderAndSwapBuffer 提交累积 Pass
+	Blend,          // 合成 Pass 的 Draw
+	Present,
+	Frame,          // 渲染线程一帧的全部工作，不含等待下一帧
+	GpuAccumulate,
+	GpuBlend,
+	Count,
+};
+
+
+// HDR 直方图: 按 2 的幂分段，每段内 128 格线性，记录任意大小的值相对误差都不超过 1/128
+// 单写者: 每个线程只写自己的直方图，计数用 relaxed 的 load + store，不需要原子加；其他线程随时可以读，读到的各格之间可能差一两次记录
+class HdrHistogram
+{
+public:
+	static constexpr uint32_t SubBucketBits      = 7;
+	static constexpr uint32_t SubBucketHalfCount = 1u << SubBucketBits;
+	static constexpr uint32_t SubBucketCount     = SubBucketHalfCount * 2;
+	static constexpr uint32_t MaxMagnitude       = 40; // 纳秒时约 18 分钟，更大的值记在最后一格
+	static constexpr uint32_t BucketCount        = SubBucketCount + (MaxMagnitude - SubBucketBits - 1) * SubBucketHalfCount;
+
+private:
+	std::atomic<uint64_t> _counts[BucketCount] = {};
+	std::atomic<uint64_t> _totalCount{0};
+	std::atomic<uint64_t> _sum{0};
+	std::atomic<uint64_t> _max{0};
+
+	static uint32_t HighestBit(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return index;
+#else
+		return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+	}
+
+	template <typename T>
+	static void Increase(std::atomic<T>& value, T amount)
+	{
+		value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+public:
+	// 小于 SubBucketCount 的值一格一个，之后 [2^m, 2^(m+1)) 分成 128 格
+	static uint32_t IndexOf(uint64_t value)
+	{
+		if (value < SubBucketCount)
+			return static_cast<uint32_t>(value);
+
+		auto magnitude = HighestBit(value);
+		if (magnitude >= MaxMagnitude)
+			return BucketCount - 1;
+
+		auto shift = magnitude - SubBucketBits;
+		return SubBucketCount + (magnitude - SubBucketBits - 1) * SubBucketHalfCount + static_cast<uint32_t>(value >> shift) - SubBucketHalfCount;
+	}
+
+	// 落在这一格的最大值，百分位取它，报告的值不会小于真实值
+	static uint64_t HighestEquivalent(uint32_t index)
+	{
+		if (index < SubBucketCount)
+			return index;
+
+		auto offset = index - SubBucketCount;
+		auto shift  = offset / SubBucketHalfCount + 1;
+		auto sub    = static_cast<uint64_t>(offset % SubBucketHalfCount + SubBucketHalfCount);
+
+		return ((sub + 1) << shift) - 1;
+	}
+
+	// 只能在拥有它的线程上调用
+	void Record(uint64_t value)
+	{
+		Increase(_counts[IndexOf(value)], uint64_t{1});
+		Increase(_sum, value);
+
+		if (value > _max.load(std::memory_order_relaxed))
+			_max.store(value, std::memory_order_relaxed);
+
+		_totalCount.store(_totalCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// 任意线程调用，把计数加到 counts（BucketCount 个）上
+	void AddTo(std::vector<uint64_t>& counts, uint64_t& totalCount, uint64_t& sum, uint64_t& max) const
+	{
+		totalCount += _totalCount.load(std::memory_order_acquire);
+		sum += _sum.load(std::memory_order_relaxed);
+		max = std::max(max, _max.load(std::memory_order_relaxed));
+
+		for (uint32_t i = 0; i < BucketCount; ++i)
+			counts[i] += _counts[i].load(std::memory_order_relaxed);
+	}
+
+	// 写入线程同时在记录时可能丢掉几次记录
+	void Reset()
+	{
+		for (auto& count : _counts)
+			count.store(0, std::memory_order_relaxed);
+
+		_sum.store(0, std::memory_order_relaxed);
+		_max.store(0, std::memory_order_relaxed);
+		_totalCount.store(0, std::memory_order_release);
+	}
+
+	// counts 里第 quantile 分位的值，没有记录时为 0
+	static uint64_t ValueAtQuantile(const std::vector<uint64_t>& counts, uint64_t totalCount, double quantile)
+	{
+		if (totalCount == 0)
+			return 0;
+
+		auto     target     = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(totalCount))), 1);
+		uint64_t cumulative = 0;
+
+		for (uint32_t i = 0; i < BucketCount; ++i)
+		{
+			cumulative += counts[i];
+
+			if (cumulative >= target)
+				return HighestEquivalent(i);
+		}
+
+		return HighestEquivalent(BucketCount - 1);
+	}
+};
+
+
+// 时间单位为微秒
+struct StageStats
+{
+	uint64_t Count;
+	double   Mean;
+	double   P50;
+	double   P99;
+	double   P999;
+	double   Max;
+};
+
+struct TelemetrySnapshot
+{
+	static constexpr auto StageCount = static_cast<size_t>(TelemetryStages::Count);
+
+	StageStats Stages[StageCount];
+	uint32_t   ThreadCount;
+
+	const StageStats& operator[](TelemetryStages stage) const { return Stages[static_cast<size_t>(stage)]; }
+};
+
+
+// 各阶段耗时的全局记录: 每个线程第一次记录时分配自己的一组直方图并登记，之后记录不加锁、不分配内存
+// Snapshot 可以在任意线程、任意时刻调用，合并所有线程的直方图；线程结束后它的记录仍然保留
+class Telemetry
+{
+public:
+	static constexpr auto StageCount = TelemetrySnapshot::StageCount;
+
+private:
+	struct ThreadRecord
+	{
+		HdrHistogram Stages[StageCount];
+	};
+
+	struct Registry
+	{
+		std::mutex                                 Mutex;
+		std::vector<std::unique_ptr<ThreadRecord>> Records;
+		std::atomic<bool>                          IsEnabled{true};
+	};
+
+	static Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	static ThreadRecord& LocalRecord()
+	{
+		static thread_local ThreadRecord* t_pRecord = nullptr;
+
+		if (t_pRecord == nullptr)
+		{
+			auto& registry = GetRegistry();
+			auto  pRecord  = std::make_unique<ThreadRecord>();
+
+			std::lock_guard<std::mutex> lock(registry.Mutex);
+			t_pRecord = pRecord.get();
+			registry.Records.push_back(std::move(pRecord));
+		}
+
+		return *t_pRecord;
+	}
+
+public:
+	static int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// 关闭后 StageTimer 不再读时钟，已有的记录保留
+	static void SetEnabled(bool enable) { GetRegistry().IsEnabled.store(enable, std::memory_order_relaxed); }
+	static bool IsEnabled() { return GetRegistry().IsEnabled.load(std::memory_order_relaxed); }
+
+	// 当前线程记录一次，单位为纳秒
+	static void Record(TelemetryStages stage, int64_t nanoseconds)
+	{
+		LocalRecord().Stages[static_cast<size_t>(stage)].Record(static_cast<uint64_t>(std::max<int64_t>(nanoseconds, 0)));
+	}
+
+	static TelemetrySnapshot Snapshot()
+	{
+		auto& registry = GetRegistry();
+
+		TelemetrySnapshot     snapshot = {};
+		std::vector<uint64_t> counts(HdrHistogram::BucketCount);
+
+		std::lock_guard<std::mutex> lock(registry.Mutex);
+		snapshot.ThreadCount = static_cast<uint32_t>(registry.Records.size());
+
+		for (size_t stage = 0; stage < StageCount; ++stage)
+		{
+			std::fill(counts.begin(), counts.end(), 0);
+
+			uint64_t totalCount = 0;
+			uint64_t sum        = 0;
+			uint64_t max        = 0;
+
+			for (const auto& pRecord : registry.Records)
+				pRecord->Stages[stage].AddTo(counts, totalCount, sum, max);
+
+			auto& stats = snapshot.Stages[stage];
+			stats.Count = totalCount;
+
+			if (totalCount == 0)
+				continue;
+
+			// 分位取格子的上沿，不超过实际的最大值
+			auto percentile = [&](double quantile) { return static_cast<double>(std::min(HdrHistogram::ValueAtQuantile(counts, totalCount, quantile), max)) * 1e-3; };
+
+			stats.Mean = static_cast<double>(sum) / static_cast<double>(totalCount) * 1e-3;
+			stats.P50  = percentile(0.5);
+			stats.P99  = percentile(0.99);
+			stats.P999 = percentile(0.999);
+			stats.Max  = static_cast<double>(max) * 1e-3;
+		}
+
+		return snapshot;
+	}
+
+	static void Reset()
+	{
+		auto& registry = GetRegistry();
+
+		std::lock_guard<std::mutex> lock(registry.Mutex);
+
+		for (const auto& pRecord : registry.Records)
+		{
+			for (auto& histogram : pRecord->Stages)
+				histogram.Reset();
+		}
+	}
+
+	static const char* StageName(TelemetryStages stage)
+	{
+		static const char* const names[] = {"gaze push", "gaze update", "constant buffer", "accumulate", "blend", "present", "frame", "gpu accumulate", "gpu blend"};
+		static_assert(sizeof(names) / sizeof(names[0]) == StageCount, "Stage names out of sync");
+
+		return names[static_cast<size_t>(stage)];
+	}
+
+	static void PrintSnapshot(std::ostream& out, const TelemetrySnapshot& snapshot)
+	{
+		out << "Telemetry, " << snapshot.ThreadCount << " threads (us)" << std::endl;
+		out << "  " << std::left << std::setw(18) << "stage" << std::right << std::setw(10) << "count" << std::setw(9) << "mean" << std::setw(9) << "p50" << std::setw(9) << "p99" << std::setw(9)
+			<< "p99.9" << std::setw(9) << "max" << std::endl;
+
+		for (size_t stage = 0; stage < StageCount; ++stage)
+		{
+			const auto& stats = snapshot.Stages[stage];
+
+			if (stats.Count == 0)
+				continue;
+
+			out << "  " << std::left << std::setw(18) << StageName(static_cast<TelemetryStages>(stage)) << std::right << std::setw(10) << stats.Count << std::fixed << std::setprecision(1)
+				<< std::setw(9) << stats.Mean << std::setw(9) << stats.P50 << std::setw(9) << stats.P99 << std::setw(9) << stats.P999 << std::setw(9) << stats.Max << std::endl;
+		}
+
+		out << std::defaultfloat;
+	}
+};
+
+
+// 作用域结束时把经过的时间记到当前线程的直方图上；Telemetry 关闭时不读时钟
+class StageTimer
+{
+	TelemetryStages _stage;
+	int64_t         _start;
+
+public:
+	explicit StageTimer(TelemetryStages stage) : _stage(stage),
+	                                             _start(Telemetry::IsEnabled() ? Telemetry::Now() : 0)
+	{
+	}
+
+	~StageTimer()
+	{
+		if (_start != 0)
+			Telemetry::Record(_stage, Telemetry::Now() - _start);
+	}
+
+	StageTimer(const StageTimer&)            = delete;
+	StageTimer& operator=(const StageTimer&) = delete;
+};
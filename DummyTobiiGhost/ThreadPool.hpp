@@ -0,0 +1,174 @@
+﻿#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// 工作窃取线程池，调用 ParallelFor 的线程也参与执行
+// 任务按连续区间平均分到每个参与者的队列里，自己从队头取，空了再从别人队尾偷，保持各自处理相邻的块
+class ThreadPool
+{
+private:
+	struct WorkQueue
+	{
+		std::mutex           Mutex;
+		std::deque<uint32_t> Tasks;
+	};
+
+	std::vector<std::thread>                _threads;
+	std::vector<std::unique_ptr<WorkQueue>> _queues;
+
+	std::mutex              _jobMutex;
+	std::condition_variable _jobCondition;
+	std::condition_variable _doneCondition;
+	uint64_t                _jobGeneration = 0;
+	bool                    _isStopping    = false;
+
+	const std::function<void(uint32_t)>* _pJob = nullptr;
+	std::atomic<uint32_t>                _remainingTasks{0};
+
+	bool PopOwn(uint32_t queueIndex, uint32_t& task)
+	{
+		auto& queue = *_queues[queueIndex];
+
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		if (queue.Tasks.empty())
+			return false;
+
+		task = queue.Tasks.front();
+		queue.Tasks.pop_front();
+		return true;
+	}
+
+	bool Steal(uint32_t queueIndex, uint32_t& task)
+	{
+		auto queueCount = static_cast<uint32_t>(_queues.size());
+
+		for (uint32_t i = 1; i < queueCount; ++i)
+		{
+			auto& queue = *_queues[(queueIndex + i) % queueCount];
+
+			std::lock_guard<std::mutex> lock(queue.Mutex);
+			if (queue.Tasks.empty())
+				continue;
+
+			task = queue.Tasks.back();
+			queue.Tasks.pop_back();
+			return true;
+		}
+
+		return false;
+	}
+
+	void RunTasks(uint32_t queueIndex)
+	{
+		uint32_t task;
+
+		while (PopOwn(queueIndex, task) || Steal(queueIndex, task))
+		{
+			(*_pJob)(task);
+
+			if (_remainingTasks.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				std::lock_guard<std::mutex> lock(_jobMutex);
+				_doneCondition.notify_all();
+			}
+		}
+	}
+
+	void WorkerLoop(uint32_t queueIndex)
+	{
+		uint64_t seenGeneration = 0;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(_jobMutex);
+				_jobCondition.wait(lock, [&] { return _isStopping || _jobGeneration != seenGeneration; });
+
+				if (_isStopping)
+					return;
+
+				seenGeneration = _jobGeneration;
+			}
+
+			RunTasks(queueIndex);
+		}
+	}
+
+public:
+	// threadCount 包含调用线程，1 表示不创建工作线程、全部在调用线程上执行
+	explicit ThreadPool(uint32_t threadCount = std::thread::hardware_concurrency())
+	{
+		threadCount = threadCount ? threadCount : 1;
+
+		for (uint32_t i = 0; i < threadCount; ++i)
+			_queues.push_back(std::make_unique<WorkQueue>());
+
+		for (uint32_t i = 1; i < threadCount; ++i)
+			_threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_jobMutex);
+			_isStopping = true;
+		}
+
+		_jobCondition.notify_all();
+
+		for (auto& thread : _threads)
+			thread.join();
+	}
+
+	ThreadPool(const ThreadPool&)            = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// 对 [0, taskCount) 的每个下标调用一次 body，全部完成后返回；不可重入
+	void ParallelFor(uint32_t taskCount, const std::function<void(uint32_t)>& body)
+	{
+		if (_threads.empty() || taskCount <= 1)
+		{
+			for (uint32_t i = 0; i < taskCount; ++i)
+				body(i);
+			return;
+		}
+
+		auto queueCount = static_cast<uint32_t>(_queues.size());
+
+		_pJob = &body;
+		_remainingTasks.store(taskCount, std::memory_order_relaxed);
+
+		for (uint32_t i = 0; i < queueCount; ++i)
+		{
+			auto& queue = *_queues[i];
+			auto  begin = static_cast<uint32_t>(static_cast<uint64_t>(taskCount) * i / queueCount);
+			auto  end   = static_cast<uint32_t>(static_cast<uint64_t>(taskCount) * (i + 1) / queueCount);
+
+			std::lock_guard<std::mutex> lock(queue.Mutex);
+			for (auto task = begin; task < end; ++task)
+				queue.Tasks.push_back(task);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_jobMutex);
+			++_jobGeneration;
+		}
+
+		_jobCondition.notify_all();
+
+		RunTasks(0);
+
+		std::unique_lock<std::mutex> lock(_jobMutex);
+		_doneCondition.wait(lock, [this] { return _remainingTasks.load(std::memory_order_acquire) == 0; });
+	}
+
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(_queues.size()); }
+};
@@ -0,0 +1,241 @@
+﻿#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "Common.h"
+#include "SoftKernels.hpp"
+
+
+// 稀疏分块的热力场，和 CreateBufferRenderTargetResource 里的 R32_FLOAT 场同尺寸
+// 按 32x32 分块，占用位图记录哪些块还活着；块内全部低于可见阈值就释放，衰减和合成都只遍历活块
+// 目前只有 Benchmark::TiledOccupancy 使用: SoftRender 仍用稠密场，惰性衰减让每帧只写 splat 覆盖的区域，合成也只走脏矩形
+class TiledHeatField
+{
+public:
+	static constexpr uint32_t TileSize = 32;
+	static constexpr uint32_t TileArea = TileSize * TileSize;
+
+	// NormalBlendPixelShader / HeatmapBlendPixelShader: alphaWdightIndex > 0.001f 才会着色
+	static constexpr float VisibleThreshold = 0.001f;
+
+private:
+	static constexpr uint32_t InvalidSlot = 0xFFFFFFFF;
+
+	uint32_t _width  = 0;
+	uint32_t _height = 0;
+	uint32_t _tilesX = 0;
+	uint32_t _tilesY = 0;
+
+	std::vector<uint64_t> _occupancy;
+	std::vector<uint32_t> _tileSlots;
+	std::vector<float>    _pool;
+	std::vector<uint32_t> _freeSlots;
+	uint32_t              _liveTileCount = 0;
+
+	SimdLevel _simdLevel = SoftKernels::ActiveSimdLevel();
+
+	static uint32_t CountTrailingZeros(uint64_t bits)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, bits);
+		return index;
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(bits));
+#endif
+	}
+
+	float*       SlotData(uint32_t slot) { return _pool.data() + static_cast<size_t>(slot) * TileArea; }
+	const float* SlotData(uint32_t slot) const { return _pool.data() + static_cast<size_t>(slot) * TileArea; }
+
+	uint32_t AllocateSlot()
+	{
+		if (!_freeSlots.empty())
+		{
+			auto slot = _freeSlots.back();
+			_freeSlots.pop_back();
+
+			memset(SlotData(slot), 0, TileArea * sizeof(float));
+			return slot;
+		}
+
+		auto slot = static_cast<uint32_t>(_pool.size() / TileArea);
+		_pool.resize(_pool.size() + TileArea, 0.0f);
+		return slot;
+	}
+
+	void FreeTile(uint32_t tileIndex)
+	{
+		_freeSlots.push_back(_tileSlots[tileIndex]);
+		_tileSlots[tileIndex] = InvalidSlot;
+
+		_occupancy[tileIndex / 64] &= ~(1ull << (tileIndex % 64));
+		--_liveTileCount;
+	}
+
+	// callback(tileIndex)，遍历过程中允许释放当前块
+	template <typename Callback>
+	void ForEachLiveTileIndex(Callback&& callback) const
+	{
+		for (size_t word = 0; word < _occupancy.size(); ++word)
+		{
+			auto bits = _occupancy[word];
+
+			while (bits)
+			{
+				auto tileIndex = static_cast<uint32_t>(word * 64 + CountTrailingZeros(bits));
+				bits &= bits - 1;
+
+				callback(tileIndex);
+			}
+		}
+	}
+
+public:
+	TiledHeatField(uint32_t width, uint32_t height)
+	{
+		Reset(width, height);
+	}
+
+	void Reset(uint32_t width, uint32_t height)
+	{
+		_width  = width;
+		_height = height;
+		_tilesX = (width + TileSize - 1) / TileSize;
+		_tilesY = (height + TileSize - 1) / TileSize;
+
+		auto tileCount = static_cast<size_t>(_tilesX) * _tilesY;
+
+		_occupancy.assign((tileCount + 63) / 64, 0);
+		_tileSlots.assign(tileCount, InvalidSlot);
+		_pool.clear();
+		_freeSlots.clear();
+		_liveTileCount = 0;
+	}
+
+	void Clear()
+	{
+		ForEachLiveTileIndex([this](uint32_t tileIndex) { FreeTile(tileIndex); });
+	}
+
+	bool IsTileLive(uint32_t tileX, uint32_t tileY) const
+	{
+		auto tileIndex = tileY * _tilesX + tileX;
+		return (_occupancy[tileIndex / 64] >> (tileIndex % 64)) & 1;
+	}
+
+	// 返回块数据（TileSize * TileSize，行优先），不存在则分配一个全零块
+	float* AcquireTile(uint32_t tileX, uint32_t tileY)
+	{
+		auto tileIndex = tileY * _tilesX + tileX;
+
+		if (_tileSlots[tileIndex] == InvalidSlot)
+		{
+			_tileSlots[tileIndex] = AllocateSlot();
+			_occupancy[tileIndex / 64] |= 1ull << (tileIndex % 64);
+			++_liveTileCount;
+		}
+
+		return SlotData(_tileSlots[tileIndex]);
+	}
+
+	// 死块返回 nullptr，其值视为 0
+	const float* GetTile(uint32_t tileX, uint32_t tileY) const
+	{
+		auto slot = _tileSlots[tileY * _tilesX + tileX];
+		return slot == InvalidSlot ? nullptr : SlotData(slot);
+	}
+
+	// 只衰减活块，衰减后整块都不可见的块直接释放
+	void Decay(float decay)
+	{
+		auto scaleMax = SoftKernels::ScaleMaxSpanKernel(_simdLevel);
+
+		ForEachLiveTileIndex([&](uint32_t tileIndex)
+		{
+			if (scaleMax(SlotData(_tileSlots[tileIndex]), TileArea, decay) < VisibleThreshold)
+				FreeTile(tileIndex);
+		});
+	}
+
+	// 在 splat 的包围盒覆盖到的块上执行 kernel，必要时分配新块；uv 仍按整张场计算
+	void Splat(SplatRowKernel kernel, const SplatParams& params)
+	{
+		auto rect = SoftKernels::SplatBounds(params, _width, _height);
+		if (rect.IsEmpty())
+			return;
+
+		for (auto tileY = rect.Top / TileSize; tileY <= (rect.Bottom - 1) / TileSize; ++tileY)
+		{
+			for (auto tileX = rect.Left / TileSize; tileX <= (rect.Right - 1) / TileSize; ++tileX)
+			{
+				auto left   = std::max(rect.Left, tileX * TileSize);
+				auto right  = std::min(rect.Right, (tileX + 1) * TileSize);
+				auto top    = std::max(rect.Top, tileY * TileSize);
+				auto bottom = std::min(rect.Bottom, (tileY + 1) * TileSize);
+
+				auto pTile = AcquireTile(tileX, tileY);
+
+				for (auto y = top; y < bottom; ++y)
+				{
+					// kernel 按场坐标 [left, right) 算 uv，pRow 指向块内第 left 列
+					auto pRow = pTile + (y - tileY * TileSize) * TileSize + (left - tileX * TileSize);
+					kernel(pRow, y, left, right, _width, _height, params);
+				}
+			}
+		}
+	}
+
+	// 与 HeatmapPixelShader 一帧等价: 先衰减活块，再把 splat 以 decay = 1 叠加
+	void AccumulateHeatmap(const PSConstantData& data)
+	{
+		auto params = SoftKernels::HeatmapParams(data);
+
+		Decay(params.Decay);
+
+		params.Decay = 1.0f;
+		Splat(SoftKernels::HeatmapRowKernel(_simdLevel), params);
+	}
+
+	// callback(tileX, tileY, const float* pTile)
+	template <typename Callback>
+	void ForEachLiveTile(Callback&& callback) const
+	{
+		ForEachLiveTileIndex([&](uint32_t tileIndex)
+		{
+			callback(tileIndex % _tilesX, tileIndex / _tilesX, SlotData(_tileSlots[tileIndex]));
+		});
+	}
+
+	// 展开成稠密场，stride 以 float 为单位
+	void ExtractDense(float* pDense, size_t stride) const
+	{
+		for (uint32_t y = 0; y < _height; ++y)
+			memset(pDense + y * stride, 0, _width * sizeof(float));
+
+		ForEachLiveTile([&](uint32_t tileX, uint32_t tileY, const float* pTile)
+		{
+			auto columns = std::min(TileSize, _width - tileX * TileSize);
+			auto rows    = std::min(TileSize, _height - tileY * TileSize);
+
+			for (uint32_t row = 0; row < rows; ++row)
+				memcpy(pDense + (tileY * TileSize + row) * stride + tileX * TileSize, pTile + row * TileSize, columns * sizeof(float));
+		});
+	}
+
+	void SetSimdLevel(SimdLevel level) { _simdLevel = std::min(level, SoftKernels::ActiveSimdLevel()); }
+
+
+	uint32_t GetWidth() const { return _width; }
+	uint32_t GetHeight() const { return _height; }
+	uint32_t GetTilesX() const { return _tilesX; }
+	uint32_t GetTilesY() const { return _tilesY; }
+	uint32_t GetTileCount() const { return _tilesX * _tilesY; }
+	uint32_t GetLiveTileCount() const { return _liveTileCount; }
+};
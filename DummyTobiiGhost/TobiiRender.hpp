@@ -1,45 +1,24 @@
 ﻿#pragma once
 
 #include <d3d11.h>
+#include <dxgi1_2.h>
 #include <dxgidebug.h>
-#include <deque>
 #include <iostream>
+#include <memory>
+#include <vector>
 
 #include "DeviceContextStore.hpp"
 #include "Common.h"
+#include "FieldChangeTracker.hpp"
+#include "GpuTimer.hpp"
 #include "Reousrce.h"
+#include "ResolutionGovernor.hpp"
+#include "SoftKernels.hpp"
+#include "Telemetry.hpp"
+#include "TobiiRenderData.hpp"
 #include "Utils.hpp"
 
 
-struct TobiiRenderSettings
-{
-	OverlayColor Color           = {0.0f, 0.74f, 1.0f, 0.8f};
-	OverlayColor BackgroundColor = {0.0f, 0.0f, 0.0f, 0.0f};
-	ShapeTypes   ShapeType       = Bubble;
-	float        Size            = 0.5f;
-	float        Trail           = 0.5f;
-	float        Decay           = 0.5f;
-	float        Responsiveness  = 0.25f;
-	bool         Enable          = true;
-};
-
-struct TobiiRenderData
-{
-	OverlayColor Color           = {1.0f, 1.0f, 1.0f, 1.0f};
-	OverlayColor BackgroundColor = {0.0f, 0.0f, 0.0f, 0.0f};
-	ShapeTypes   ShapeType       = Bubble;
-	float        Size            = 0.07f;
-	float        Trail           = 0.5f;
-	float        Decay           = 0.95f;
-	float        Responsiveness  = 0.25f;
-	bool         Enable          = true;
-
-	bool DataIsDirty            = false;
-	bool BackgroundColorIsDirty = false;
-
-	std::deque<Point> GazePoints;
-};
-
 class TobiiRender
 {
 private:
@@ -47,7 +26,8 @@ private:
 	ID3D11DeviceContext* _pDeviceContext = nullptr;
 	ID3D11Debug*         _pDebug         = nullptr;
 
-	IDXGISwapChain* _pDXGISwapChain = nullptr;
+	IDXGISwapChain*  _pDXGISwapChain  = nullptr;
+	IDXGISwapChain1* _pDXGISwapChain1 = nullptr;
 	IDXGIDebug1*    _pDXGIDebug     = nullptr;
 
 
@@ -81,7 +61,46 @@ private:
 
 	TobiiRenderData _renderData = {};
 
-	const UINT _downsampleFactor = 4;
+	// 眼动仪线程写入，渲染线程每帧 ConsumeGazeSamples 时取走
+	GazeRing _gazeRing;
+
+	UINT               _downsampleFactor = 4;
+	ResolutionGovernor _governor         = {};
+	GpuTimer           _gpuTimer         = {};
+
+	// 按每帧 Pass 的参数推算哪些块有可见变化，不需要读回场纹理
+	FieldChangeTracker _changeTracker = {};
+
+	// 本帧相对上一次 Present 变化的矩形，以及上一次合成的矩形
+	// 交换链两个缓冲轮流使用，当前后台缓冲停留在上上次 Present 的内容，要把上一次的矩形一起补画
+	std::vector<FieldRect> _dirtyRects;
+	std::vector<FieldRect> _previousDirtyRects;
+	std::vector<FieldRect> _drawRects;
+	std::vector<RECT>      _presentRects;
+
+	void ResetChangeTracker()
+	{
+		_changeTracker.Reset(std::max(_width / _downsampleFactor, 1u), std::max(_height / _downsampleFactor, 1u), _renderData.FieldPeak);
+	}
+
+	// 合成 Shader 与 SoftRender 的查找表一致，用同一张表决定多大的场值变化算可见
+	void UpdateChangeThreshold()
+	{
+		PSConstantData data = {};
+		_renderData.FillConstantData(data, static_cast<float>(_width), static_cast<float>(_height));
+
+		CompositeParams params = {};
+		params.pShapePixels    = _renderData.ShapeType == Heatmap ? Resource::HeatmapPixelsBytes : _renderData.ShapeType == Solid ? Resource::SolidPixelsBytes : Resource::BubblePixelsBytes;
+		params.ShapeWidth      = sizeof(Resource::SolidPixelsBytes) / sizeof(uint32_t);
+		params.Color           = data.Color;
+		params.BackgroundColor = data.BackgroundColor;
+		params.IsHeatmap       = _renderData.ShapeType == Heatmap;
+
+		auto pLut = std::make_unique<CompositeLut>();
+		SoftKernels::BuildCompositeLut(*pLut, params);
+
+		_changeTracker.SetCompositeLut(*pLut);
+	}
 
 	bool CreateDevice()
 	{
@@ -97,6 +116,7 @@ private:
 		swapChainDesc.SampleDesc.Count   = 1;
 		swapChainDesc.SampleDesc.Quality = 0;
 		swapChainDesc.Windowed           = TRUE;
+		swapChainDesc.SwapEffect         = DXGI_SWAP_EFFECT_SEQUENTIAL; // 只重画脏矩形，Present 后后台缓冲的内容要保留
 		swapChainDesc.Flags              = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
 
 		UINT createDeviceFlags = 0;
@@ -116,6 +136,10 @@ private:
 			return false;
 		}
 
+		// 拿不到 IDXGISwapChain1 时退回普通 Present，不传脏矩形
+		if (FAILED(_pDXGISwapChain->QueryInterface(IID_PPV_ARGS(&_pDXGISwapChain1))))
+			_pDXGISwapChain1 = nullptr;
+
 		if (createDeviceFlags & D3D11_CREATE_DEVICE_DEBUG)
 		{
 			auto hr = _pDevice->QueryInterface(IID_PPV_ARGS(&_pDebug));
@@ -139,6 +163,7 @@ private:
 		CleanupMainRenderTarget();
 
 
+		Utils::SafeRelease(_pDXGISwapChain1);
 		Utils::SafeRelease(_pDXGISwapChain);
 		Utils::SafeRelease(_pDebug);
 		Utils::SafeRelease(_pDeviceContext);
@@ -188,8 +213,8 @@ private:
 	{
 		D3D11_TEXTURE2D_DESC texDesc;
 		ZeroMemory(&texDesc, sizeof(D3D11_TEXTURE2D_DESC));
-		texDesc.Width            = _width ? _width / _downsampleFactor : 1;
-		texDesc.Height           = _height ? _height / _downsampleFactor : 1;
+		texDesc.Width            = std::max(_width / _downsampleFactor, 1u);
+		texDesc.Height           = std::max(_height / _downsampleFactor, 1u);
 		texDesc.MipLevels        = 1;
 		texDesc.ArraySize        = 1;
 		texDesc.Format           = DXGI_FORMAT_R32_FLOAT;
@@ -233,6 +258,77 @@ private:
 		_frontRenderTargetResource.Release();
 	}
 
+	// 按新的降采样倍数重建前后缓冲，用 Solid Pass（decay = 1）经线性采样把旧的场画过去，热量不会丢
+	// 需要在 Render 设置好 IA/VS/RS/常量缓冲/采样器之后调用
+	bool ResampleBufferRenderTargetResource(UINT factor)
+	{
+		auto oldFront  = _frontRenderTargetResource;
+		auto oldBack   = _backRenderTargetResource;
+		auto oldFactor = _downsampleFactor;
+
+		_frontRenderTargetResource = {};
+		_backRenderTargetResource  = {};
+		_downsampleFactor          = factor;
+
+		if (!CreateBufferRenderTargetResource())
+		{
+			std::cerr << "Create Buffer Render Target For Downsample Factor " << factor << " Failed" << std::endl;
+
+			_frontRenderTargetResource = oldFront;
+			_backRenderTargetResource  = oldBack;
+			_downsampleFactor          = oldFactor;
+			return false;
+		}
+
+		auto resampleData  = *_pPSConstantData;
+		resampleData.Decay = 1.0f;
+
+		if (UpdateConstantBuffer(resampleData))
+		{
+			DeviceContextStore contextStore(_pDeviceContext);
+			contextStore.OMSetRenderTargets(1, &_frontRenderTargetResource.pRtv, nullptr);
+
+			const D3D11_RECT clipRect = {0, 0, static_cast<long>(_width / _downsampleFactor), static_cast<long>(_height / _downsampleFactor)};
+			contextStore.RSSetScissorRects(1, &clipRect);
+
+			const D3D11_VIEWPORT viewport = {0.0f, 0.0f, static_cast<float>(_width / _downsampleFactor), static_cast<float>(_height / _downsampleFactor), 0.0f, 1.0f};
+			contextStore.RSSetViewports(1, &viewport);
+
+			contextStore.PSSetShader(_pPixelShaderSolid, nullptr, 0);
+			contextStore.PSSetShaderResources(0, 1, &oldFront.pSrv);
+			_pDeviceContext->Draw(_vertexCount, 0);
+		}
+
+		oldFront.Release();
+		oldBack.Release();
+
+		// 常量缓冲被临时改过，本帧需要重新填
+		_renderData.DataIsDirty = true;
+
+		ResetChangeTracker();
+		return true;
+	}
+
+	bool UpdateConstantBuffer(const PSConstantData& data)
+	{
+		StageTimer timer(TelemetryStages::ConstantBuffer);
+
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+		ZeroMemory(&mappedResource, sizeof(D3D11_MAPPED_SUBRESOURCE));
+
+		auto hr = _pDeviceContext->Map(_pPSConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+		if (FAILED(hr))
+		{
+			std::cerr << "Map Pixel Shader Constant Buffer Failed: " << Utils::HrToString(hr) << std::endl;
+			return false;
+		}
+
+		memcpy(mappedResource.pData, &data, sizeof(PSConstantData));
+
+		_pDeviceContext->Unmap(_pPSConstantBuffer, 0);
+		return true;
+	}
+
 	bool CreateShaderResource()
 	{
 #pragma region VertexShader
@@ -485,7 +581,7 @@ private:
 			contextStore.RSSetViewports(1, &viewport);
 
 			auto pPixelShader = _pPixelShaderSolid;
-			if (!_renderData.GazePoints.empty())
+			if (_renderData.HasGaze())
 			{
 				if (_renderData.ShapeType == Heatmap)
 				{
@@ -503,6 +599,19 @@ private:
 
 
 		std::swap(_frontRenderTargetResource, _backRenderTargetResource);
+
+		// 与 SoftRender 同样的上界，GainScale 为 1 时 Shader 里的 gain 与 SoftKernels 的参数一致
+		if (!_renderData.HasGaze())
+		{
+			_renderData.TrackFieldPeak(_pPSConstantData->Decay, 0.0f);
+			_changeTracker.TrackDecay(_pPSConstantData->Decay);
+		}
+		else
+		{
+			auto params = _renderData.ShapeType == Heatmap ? SoftKernels::HeatmapParams(*_pPSConstantData) : SoftKernels::BubbleParams(*_pPSConstantData);
+			_renderData.TrackFieldPeak(params.Decay, params.Gain);
+			_changeTracker.TrackSplat(params, _renderData.ShapeType != Heatmap);
+		}
 	}
 
 public:
@@ -526,6 +635,11 @@ public:
 			_pPSConstantData = static_cast<PSConstantData*>(_aligned_malloc(sizeof(PSConstantData), 16));
 			ZeroMemory(_pPSConstantData, sizeof(PSConstantData));
 
+			// 拿不到时间戳查询只影响分辨率调节，不算初始化失败
+			_gpuTimer.Init(_pDevice);
+
+			ResetChangeTracker();
+
 			return true;
 		}
 		// @formatter:on
@@ -538,8 +652,14 @@ public:
 		return false;
 	}
 
-	void Render()
+	// 返回 true 表示主渲染目标有了可见变化，需要 Present；场的变化都在 8 位量化级以内时不执行合成 Pass
+	// 合成只画变化的块所在的矩形（GetDirtyRects），Present 时作为脏矩形传给 DXGI
+	bool Render()
 	{
+		auto isChanged = false;
+
+		_dirtyRects.clear();
+
 		{
 			DeviceContextStore contextStore(_pDeviceContext);
 			unsigned int       stride = sizeof(Vertex);
@@ -571,6 +691,11 @@ public:
 				_pDeviceContext->ClearRenderTargetView(_pMainRtv, clearColorWithAlpha);
 
 				_renderData.BackgroundColorIsDirty = false;
+
+				_changeTracker.MarkAllDirty();
+				isChanged = true;
+
+				_dirtyRects.push_back({0, 0, _width, _height});
 			}
 
 			if (_renderData.Enable)
@@ -578,20 +703,31 @@ public:
 				auto fWidth  = static_cast<float>(_width);
 				auto fHeight = static_cast<float>(_height);
 
-				if (_renderData.DataIsDirty || !_renderData.GazePoints.empty())
+				// 几帧前的 GPU 耗时交给 governor，换档后先把场重采样到新尺寸；分段的耗时记到 Telemetry，没有合成的帧只有累积一段
+				double gpuSeconds;
+				double gpuStages[GpuTimer::MaxTimestamps - 1];
+				UINT   gpuStageCount = 0;
+
+				if (_gpuTimer.TryResolve(_pDeviceContext, gpuSeconds, gpuStages, &gpuStageCount))
 				{
-					ZeroMemory(_pPSConstantData, sizeof(PSConstantData));
+					_governor.Update(gpuSeconds);
 
+					if (gpuStageCount > 0)
+						Telemetry::Record(TelemetryStages::GpuAccumulate, static_cast<int64_t>(gpuStages[0] * 1e9));
 
-					if (!_renderData.GazePoints.empty())
-					{
-						auto gazePoint = _renderData.GazePoints.front();
+					if (gpuStageCount > 1)
+						Telemetry::Record(TelemetryStages::GpuBlend, static_cast<int64_t>(gpuStages[1] * 1e9));
+				}
 
-						_pPSConstantData->GazePoint.X = gazePoint.X / fWidth;
-						_pPSConstantData->GazePoint.Y = gazePoint.Y / fHeight;
-					}
+				if (_governor.GetDownsampleFactor() != _downsampleFactor && !ResampleBufferRenderTargetResource(_governor.GetDownsampleFactor()))
+					_governor.SetDownsampleFactor(_downsampleFactor);
 
-					_pPSConstantData->AspectRatio = fWidth / fHeight;
+				if (_renderData.DataIsDirty || _renderData.HasGaze())
+				{
+					_renderData.FillConstantData(*_pPSConstantData, fWidth, fHeight);
+
+					// 内嵌的 Shader 字节码没有 gainScale，每帧固定加 0.03 / 1.7，峰值和脏块的上界要按同样的值估计
+					_pPSConstantData->GainScale = 1.0f;
 
 					static auto lastAspectRatio = 0.0f;
 
@@ -602,62 +738,99 @@ public:
 						std::cout << "Aspect Ratio: " << lastAspectRatio << std::endl;
 					}
 
+					if (!UpdateConstantBuffer(*_pPSConstantData))
+						return isChanged;
 
-					_pPSConstantData->Decay           = _renderData.ShapeType == Heatmap ? _renderData.Decay : 0.95f;
-					_pPSConstantData->SizeSquared     = _renderData.Size * _renderData.Size;
-					_pPSConstantData->Trail           = _renderData.Trail;
-					_pPSConstantData->Color           = _renderData.ShapeType == Heatmap ? OverlayColor{1.0f, 1.0f, 1.0f, 0.6f} : _renderData.Color;
-					_pPSConstantData->BackgroundColor = _renderData.ShapeType == Heatmap ? OverlayColor{0.0f, 0.0f, 0.0f, 0.0f} : _renderData.BackgroundColor;
+					_renderData.DataIsDirty = false;
+				}
 
-					D3D11_MAPPED_SUBRESOURCE mappedResource;
-					ZeroMemory(&mappedResource, sizeof(D3D11_MAPPED_SUBRESOURCE));
+				auto isTiming = _gpuTimer.Begin(_pDeviceContext);
 
-					auto hr = _pDeviceContext->Map(_pPSConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-					if (FAILED(hr))
-					{
-						std::cerr << "Map Pixel Shader Constant Buffer Failed: " << Utils::HrToString(hr) << std::endl;
-						return;
-					}
+				{
+					StageTimer timer(TelemetryStages::Accumulate);
+					RenderAndSwapBuffer();
+				}
 
-					memcpy(mappedResource.pData, _pPSConstantData, sizeof(PSConstantData));
+				if (_changeTracker.HasChanges())
+				{
+					StageTimer timer(TelemetryStages::Blend);
 
-					_pDeviceContext->Unmap(_pPSConstantBuffer, 0);
+					if (isTiming)
+						_gpuTimer.Mark(_pDeviceContext);
 
-					_renderData.DataIsDirty = false;
-				}
+					_dirtyRects.clear();
+					_changeTracker.CollectDirtyRects(_width, _height, _dirtyRects);
 
-				RenderAndSwapBuffer();
+					_drawRects = _dirtyRects;
+					_drawRects.insert(_drawRects.end(), _previousDirtyRects.begin(), _previousDirtyRects.end());
+					FieldChangeTracker::CapRects(_drawRects, FieldChangeTracker::MaxDirtyRects);
 
-				contextStore.OMSetRenderTargets(1, &_pMainRtv, nullptr);
-				contextStore.RSSetScissorRects(1, &_dxRect);
+					contextStore.OMSetRenderTargets(1, &_pMainRtv, nullptr);
 
-				const D3D11_VIEWPORT viewport = {0.0f, 0.0f, fWidth, fHeight, 0.0f, 1.0f};
-				contextStore.RSSetViewports(1, &viewport);
+					const D3D11_VIEWPORT viewport = {0.0f, 0.0f, fWidth, fHeight, 0.0f, 1.0f};
+					contextStore.RSSetViewports(1, &viewport);
 
-				auto pPixelShader = _pPixelShaderNormalBlend;
+					auto pPixelShader = _pPixelShaderNormalBlend;
 
-				if (_renderData.ShapeType == Heatmap)
-				{
-					pPixelShader = _pPixelShaderHeatmapBlend;
-				}
+					if (_renderData.ShapeType == Heatmap)
+					{
+						pPixelShader = _pPixelShaderHeatmapBlend;
+					}
+
+					contextStore.PSSetShader(pPixelShader, nullptr, 0);
+					contextStore.PSSetShaderResources(0, 1, &_frontRenderTargetResource.pSrv);
+
+					if (_shapeResource.pSrv)
+						contextStore.PSSetShaderResources(1, 1, &_shapeResource.pSrv);
+
+					// 合成是覆盖写，矩形重叠的部分画两遍结果也一样
+					for (const auto& rect : _drawRects)
+					{
+						const D3D11_RECT clipRect = {static_cast<long>(rect.Left), static_cast<long>(rect.Top), static_cast<long>(rect.Right), static_cast<long>(rect.Bottom)};
+						contextStore.RSSetScissorRects(1, &clipRect);
 
-				contextStore.PSSetShader(pPixelShader, nullptr, 0);
-				contextStore.PSSetShaderResources(0, 1, &_frontRenderTargetResource.pSrv);
+						_pDeviceContext->Draw(_vertexCount, 0);
+					}
+
+					_previousDirtyRects = _dirtyRects;
 
-				if (_shapeResource.pSrv)
-					contextStore.PSSetShaderResources(1, 1, &_shapeResource.pSrv);
+					_changeTracker.MarkClean();
+					isChanged = true;
+				}
 
-				_pDeviceContext->Draw(_vertexCount, 0);
+				if (isTiming)
+					_gpuTimer.End(_pDeviceContext);
 			}
 		}
+
+		return isChanged;
 	}
 
-	HRESULT Present(UINT SyncInterval = 1, UINT Flags = 0) const
+	// 带上本帧的脏矩形，DXGI 只需要更新这些区域；DXGI_PRESENT_TEST 等不产生新画面的调用走普通 Present
+	HRESULT Present(UINT SyncInterval = 1, UINT Flags = 0)
 	{
 		if (_pDXGISwapChain == nullptr)
 			return E_FAIL;
 
-		return _pDXGISwapChain->Present(SyncInterval, Flags);
+		if (Flags & DXGI_PRESENT_TEST)
+			return _pDXGISwapChain->Present(SyncInterval, Flags);
+
+		// 只记真正产生新画面的 Present，DXGI_PRESENT_TEST 不算
+		StageTimer timer(TelemetryStages::Present);
+
+		if (_pDXGISwapChain1 == nullptr || _dirtyRects.empty())
+			return _pDXGISwapChain->Present(SyncInterval, Flags);
+
+		_presentRects.clear();
+
+		for (const auto& rect : _dirtyRects)
+			_presentRects.push_back({static_cast<long>(rect.Left), static_cast<long>(rect.Top), static_cast<long>(rect.Right), static_cast<long>(rect.Bottom)});
+
+		DXGI_PRESENT_PARAMETERS parameters = {};
+		parameters.DirtyRectsCount         = static_cast<UINT>(_presentRects.size());
+		parameters.pDirtyRects             = _presentRects.data();
+
+		return _pDXGISwapChain1->Present1(SyncInterval, Flags, &parameters);
 	}
 
 	bool Resize(UINT width, UINT height)
@@ -669,7 +842,8 @@ public:
 		_dxRect.right  = _width  = width;
 		_dxRect.bottom = _height = height;
 
-		_renderData.GazePoints.clear();
+		_renderData.ClearGaze();
+		_renderData.FieldPeak = 0.0f;
 
 		CleanupBufferRenderTargetResource();
 		CleanupMainRenderTarget();
@@ -683,7 +857,18 @@ public:
 		}
 
 		if (CreateMainRenderTarget() && CreateBufferRenderTargetResource())
+		{
+			// 新建的场纹理内容未定义，清零后 FieldPeak 才是它的上界
+			FLOAT clearColor[4] = {0, 0, 0, 0};
+			_pDeviceContext->ClearRenderTargetView(_frontRenderTargetResource.pRtv, clearColor);
+			_pDeviceContext->ClearRenderTargetView(_backRenderTargetResource.pRtv, clearColor);
+
+			// 窗口尺寸变了，背景需要重新铺满
+			_renderData.BackgroundColorIsDirty = true;
+
+			ResetChangeTracker();
 			return true;
+		}
 
 		CleanupBufferRenderTargetResource();
 		CleanupMainRenderTarget();
@@ -693,6 +878,7 @@ public:
 
 	void Release()
 	{
+		_gpuTimer.Release();
 		CleanupShapeResource();
 		CleanupShaderSource();
 		CleanupMainRenderTarget();
@@ -701,35 +887,7 @@ public:
 
 	void UpdateSettings(const TobiiRenderSettings& settings)
 	{
-		_renderData.DataIsDirty = true;
-
-		auto backgroundColorChanged = memcmp(&_renderData.BackgroundColor, &settings.BackgroundColor, sizeof(OverlayColor)) != 0;
-
-		auto shapeChanged = _renderData.ShapeType != settings.ShapeType;
-
-		if (backgroundColorChanged || _renderData.Enable != settings.Enable || shapeChanged)
-		{
-			_renderData.BackgroundColorIsDirty = true;
-		}
-
-
-		// 更新 RenderContext 的其他属性
-		_renderData.ShapeType       = settings.ShapeType;
-		_renderData.Enable          = settings.Enable;
-		_renderData.BackgroundColor = settings.BackgroundColor;
-		_renderData.Size            = std::fmax(settings.Size, 0.0f) * 0.15f;
-		_renderData.Responsiveness  = settings.Responsiveness;
-
-		if (_renderData.ShapeType == Heatmap)
-		{
-			//0.9975f
-			_renderData.Decay = 0.9975f - settings.Decay * 0.0025f;
-		}
-		else
-		{
-			_renderData.Trail = settings.Trail;
-			_renderData.Color = settings.Color;
-		}
+		auto shapeChanged = _renderData.ApplySettings(settings);
 
 		if (shapeChanged)
 		{
@@ -741,45 +899,78 @@ public:
 			FLOAT clearColor[4] = {0, 0, 0, 0};
 			_pDeviceContext->ClearRenderTargetView(_frontRenderTargetResource.pRtv, clearColor);
 			_pDeviceContext->ClearRenderTargetView(_backRenderTargetResource.pRtv, clearColor);
+
+			_changeTracker.TrackClear();
 		}
+
+		// 颜色、形状等设置都会改变合成结果
+		UpdateChangeThreshold();
+		_changeTracker.MarkAllDirty();
 	}
 
 	void PushGazePoint(bool isActive, Point gazePoint)
 	{
-		if (isActive && _renderData.Enable)
-		{
-			auto Responsiveness = _renderData.Responsiveness * 0.9f + 0.1f;
-			auto X              = gazePoint.X;
-			auto Y              = gazePoint.Y;
+		StageTimer timer(TelemetryStages::GazeUpdate);
+		_renderData.PushGazePoint(isActive, gazePoint);
+	}
 
-			if (!_renderData.GazePoints.empty())
-			{
-				X = _renderData.GazePoints.back().X;
-				Y = _renderData.GazePoints.back().Y;
-			}
+	// 每帧 Render 前在渲染线程调用一次，代替 PushGazePoint；frameTimestamp 为本帧开始的时间（微秒）
+	void ConsumeGazeSamples(int64_t frameTimestamp)
+	{
+		StageTimer timer(TelemetryStages::GazeUpdate);
+		_renderData.ConsumeGazeSamples(_gazeRing, frameTimestamp);
+	}
 
-			for (auto i = 0; i < 3; ++i)
-			{
-				auto t    = (i + 1) * 0.33333334f * Responsiveness;
-				auto newX = (gazePoint.X - X) * t + X;
-				auto newY = (gazePoint.Y - Y) * t + Y;
+	// 不渲染的节拍调用: 取走全部采样交给平滑和预测，不推进注视点；返回上一帧之后是否来过采样，latest 为其中最新的一个
+	bool DrainGazeSamples(GazeSample& latest)
+	{
+		StageTimer timer(TelemetryStages::GazeUpdate);
+		_renderData.DrainGazeSamples(_gazeRing);
 
-				_renderData.GazePoints.push_back({newX, newY});
-			}
+		latest = _renderData.PendingSample;
+		return _renderData.HasPendingSample;
+	}
 
-			if (_renderData.GazePoints.size() > 3)
-			{
-				while (_renderData.GazePoints.size() > 3)
-					_renderData.GazePoints.pop_front();
-			}
-		}
+	// 生产者一端，可以交给眼动仪的回调线程，Timestamp 单位为微秒
+	GazeRing& GetGazeRing() { return _gazeRing; }
 
-		if (!_renderData.GazePoints.empty())
-			_renderData.GazePoints.pop_front();
+	// 没有待画的注视点、整张场已不可见且背景不需要重画时，再 Render/Present 画面也不会变
+	bool IsIdle() const
+	{
+		return !_renderData.HasGaze() && _renderData.IsFieldConverged() && !_renderData.BackgroundColorIsDirty;
 	}
 
+	// 每帧 Render 前传入当前时间（微秒），TimeBasedDecay 打开时按真实 dt 衰减
+	void AdvanceFrame(int64_t timestamp)
+	{
+		_renderData.AdvanceFrame(timestamp);
+	}
+
+
+	// 上次调用以来场的活跃程度（量化级），见 FieldChangeTracker::TakeActivity
+	float TakeFieldActivity() { return _changeTracker.TakeActivity(); }
+
+
+	// 每帧累积 + 合成 GPU 耗时的预算（秒），超出时自动降低场的分辨率，0 表示固定倍数
+	void SetFrameBudget(double seconds)
+	{
+		_governor.SetBudget(seconds);
+	}
+
+	// 下一帧 Render 时生效，取 2/4/8/16 中不小于 factor 的最近一档
+	void SetDownsampleFactor(UINT factor)
+	{
+		_governor.SetDownsampleFactor(factor);
+	}
+
+
+	UINT                      GetDownsampleFactor() const { return _downsampleFactor; }
+	const TobiiRenderData&    GetRenderData() const { return _renderData; }
+	const FieldChangeTracker& GetChangeTracker() const { return _changeTracker; }
+	ID3D11Device*             GetDevice() const { return _pDevice; }
+	ID3D11DeviceContext*      GetDeviceContext() const { return _pDeviceContext; }
+	IDXGISwapChain*           GetSwapChain() const { return _pDXGISwapChain; }
 
-	ID3D11Device*        GetDevice() const { return _pDevice; }
-	ID3D11DeviceContext* GetDeviceContext() const { return _pDeviceContext; }
-	IDXGISwapChain*      GetSwapChain() const { return _pDXGISwapChain; }
+	// 上一次 Render 相对上一次 Present 变化的输出矩形，Right/Bottom 不包含
+	const std::vector<FieldRect>& GetDirtyRects() const { return _dirtyRects; }
 };
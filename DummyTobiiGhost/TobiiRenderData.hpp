@@ -0,0 +1,317 @@
+﻿#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "Common.h"
+#include "FixationClassifier.hpp"
+#include "GazePredictor.hpp"
+#include "OneEuroFilter.hpp"
+#include "SpscRing.hpp"
+
+
+struct TobiiRenderSettings
+{
+	OverlayColor Color           = {0.0f, 0.74f, 1.0f, 0.8f};
+	OverlayColor BackgroundColor = {0.0f, 0.0f, 0.0f, 0.0f};
+	ShapeTypes   ShapeType       = Bubble;
+	float        Size            = 0.5f;
+	float        Trail           = 0.5f;
+	float        Decay           = 0.5f;
+	float        Responsiveness  = 0.25f;
+	bool         Enable          = true;
+
+	// Lerp: 每帧向最新注视点插值 Responsiveness；OneEuro: 按采样时间做 One-Euro 滤波，Responsiveness 决定截止频率
+	SmoothingModes SmoothingMode = SmoothingModes::Lerp;
+
+	// Heatmap 只累积注视（按时长加权），扫视和注视之间的过渡不产生热量
+	bool            HeatmapFixationsOnly = false;
+	ClassifierModes FixationClassifier   = ClassifierModes::Velocity;
+
+	// 按真实经过的时间衰减（decay^dt），与实际帧率无关，跳帧后下一帧一次补齐
+	// splat 热量按 dt 缩放只在 SoftRender 上生效，GPU 上每帧仍加固定的热量
+	bool TimeBasedDecay = false;
+
+	// 把注视点外推到预计显示的时间: 帧开始时间 + PredictionLatency 秒（渲染、Present 到扫描输出的延迟）
+	// 回放基准（5 像素噪声）里 Kalman 在 8/16/33 ms 的平均误差都比不预测低 5%~10%
+	PredictionModes PredictionMode    = PredictionModes::Kalman;
+	float           PredictionLatency = 0.016f;
+};
+
+struct TobiiRenderData
+{
+	OverlayColor Color           = {1.0f, 1.0f, 1.0f, 1.0f};
+	OverlayColor BackgroundColor = {0.0f, 0.0f, 0.0f, 0.0f};
+	ShapeTypes   ShapeType       = Bubble;
+	float        Size            = 0.07f;
+	float        Trail           = 0.5f;
+	float        Decay           = 0.95f;
+	float        Responsiveness  = 0.25f;
+	bool         Enable          = true;
+
+	int64_t       PredictionLatency = 16000; // 微秒
+	GazePredictor Predictor;
+
+	SmoothingModes SmoothingMode = SmoothingModes::Lerp;
+	OneEuroFilter  Smoother;
+
+	// HeatmapFixationsOnly 时注视点取当前注视的中心，不在注视中就不产生热量
+	bool               HeatmapFixationsOnly = false;
+	FixationClassifier Classifier;
+
+	// 上一帧之后取走的最新采样（可能无效），下一次 ConsumeGazeSamples 时清掉
+	bool       HasPendingSample = false;
+	GazeSample PendingSample    = {};
+
+	bool DataIsDirty            = false;
+	bool BackgroundColorIsDirty = false;
+
+	// PushGazePoint 把到最新注视点的路径插成 3 段，之后每帧取一段；固定容量，不分配内存
+	static constexpr uint32_t GazeStepCount = 3;
+
+	Point    GazeSteps[GazeStepCount] = {};
+	uint32_t GazeStepIndex            = GazeStepCount;
+
+	// Decay 是按 Main.cpp 里 120 帧调出来的每帧系数，按时间衰减时换算成 Decay^(dt * 120)
+	static constexpr float ReferenceFrameRate = 120.0f;
+	// 跳帧补齐时衰减按完整时长计算，但一帧最多补这么多秒的 splat 热量
+	static constexpr float MaxSplatDuration = 0.1f;
+
+	bool    TimeBasedDecay     = false;
+	int64_t LastFrameTimestamp = 0;
+	float   FrameDelta         = 1.0f / ReferenceFrameRate;
+
+	// 合成 Pass 里 alphaWdightIndex > 0.001f 才会着色
+	static constexpr float VisibleThreshold = 0.001f;
+
+	// 场里最大值的上界，每个 Pass 后按 peak * decay + gain 推进（各 Pass 的实际系数都不超过 decay）
+	// 低于 VisibleThreshold 说明整张场都不可见了，不需要读回场就能判断
+	float FieldPeak = 0.0f;
+
+	// 返回 ShapeType 是否发生变化，调用方需要重建形状纹理并清空场
+	bool ApplySettings(const TobiiRenderSettings& settings)
+	{
+		DataIsDirty = true;
+
+		auto backgroundColorChanged = memcmp(&BackgroundColor, &settings.BackgroundColor, sizeof(OverlayColor)) != 0;
+
+		auto shapeChanged = ShapeType != settings.ShapeType;
+
+		if (backgroundColorChanged || Enable != settings.Enable || shapeChanged)
+		{
+			BackgroundColorIsDirty = true;
+		}
+
+		// 换形状时两个渲染器都会清空场
+		if (shapeChanged)
+			FieldPeak = 0.0f;
+
+
+		// 更新 RenderContext 的其他属性
+		ShapeType       = settings.ShapeType;
+		Enable          = settings.Enable;
+		BackgroundColor = settings.BackgroundColor;
+		Size            = std::fmax(settings.Size, 0.0f) * 0.15f;
+		Responsiveness  = settings.Responsiveness;
+		TimeBasedDecay  = settings.TimeBasedDecay;
+
+		PredictionLatency = static_cast<int64_t>(std::fmax(settings.PredictionLatency, 0.0f) * 1e6f);
+
+		if (Predictor.GetMode() != settings.PredictionMode)
+			Predictor.SetMode(settings.PredictionMode);
+
+		if (SmoothingMode != settings.SmoothingMode)
+		{
+			SmoothingMode = settings.SmoothingMode;
+			Smoother.Reset();
+		}
+
+		Smoother.SetParams(OneEuroFilter::FromResponsiveness(Responsiveness));
+
+		if (HeatmapFixationsOnly != settings.HeatmapFixationsOnly || Classifier.GetParams().Mode != settings.FixationClassifier)
+		{
+			auto params = Classifier.GetParams();
+			params.Mode = settings.FixationClassifier;
+
+			HeatmapFixationsOnly = settings.HeatmapFixationsOnly;
+			Classifier.SetParams(params);
+		}
+
+		if (ShapeType == Heatmap)
+		{
+			//0.9975f
+			Decay = 0.9975f - settings.Decay * 0.0025f;
+		}
+		else
+		{
+			Trail = settings.Trail;
+			Color = settings.Color;
+		}
+
+		return shapeChanged;
+	}
+
+	void PushGazePoint(bool isActive, Point gazePoint)
+	{
+		if (isActive && Enable && SmoothingMode == SmoothingModes::OneEuro)
+		{
+			// 已经在 ConsumeGazeSamples 里按采样滤波过，不再插值
+			for (auto& step : GazeSteps)
+				step = gazePoint;
+
+			GazeStepIndex = 0;
+		}
+		else if (isActive && Enable)
+		{
+			auto responsiveness = Responsiveness * 0.9f + 0.1f;
+			auto X              = gazePoint.X;
+			auto Y              = gazePoint.Y;
+
+			if (HasGaze())
+			{
+				X = GazeSteps[GazeStepCount - 1].X;
+				Y = GazeSteps[GazeStepCount - 1].Y;
+			}
+
+			for (uint32_t i = 0; i < GazeStepCount; ++i)
+			{
+				auto t    = (i + 1) * 0.33333334f * responsiveness;
+				auto newX = (gazePoint.X - X) * t + X;
+				auto newY = (gazePoint.Y - Y) * t + Y;
+
+				GazeSteps[i] = {newX, newY};
+			}
+
+			GazeStepIndex = 0;
+		}
+
+		if (HasGaze())
+			++GazeStepIndex;
+	}
+
+	// 取走环形缓冲里的全部采样（OneEuro 模式下先逐个滤波）交给分类器和预测器，不推进注视点
+	// 自适应帧率不渲染的节拍也要调用，否则停止渲染期间环形缓冲被填满，之后的新采样全部丢掉
+	void DrainGazeSamples(GazeRing& ring)
+	{
+		auto isFixationsOnly = HeatmapFixationsOnly && ShapeType == Heatmap;
+
+		ring.PopAll([&](const GazeSample& sample)
+		{
+			HasPendingSample = true;
+			PendingSample    = sample;
+
+			if (isFixationsOnly)
+				Classifier.AddSample(sample, [](const FixationEvent&) {});
+
+			if (SmoothingMode != SmoothingModes::OneEuro)
+			{
+				Predictor.AddSample(sample);
+				return;
+			}
+
+			if (!sample.IsValid)
+			{
+				Smoother.Reset();
+				Predictor.AddSample(sample);
+				return;
+			}
+
+			Predictor.AddSample({sample.Timestamp, Smoother.Filter(sample), true});
+		});
+	}
+
+	// 取走剩下的采样，按预测到 frameTimestamp + PredictionLatency（微秒）的位置推进注视点
+	// 上一帧之后没有新采样或最新采样无效时按没有注视处理
+	void ConsumeGazeSamples(GazeRing& ring, int64_t frameTimestamp)
+	{
+		DrainGazeSamples(ring);
+
+		auto isActive        = HasPendingSample && PendingSample.IsValid;
+		auto isFixationsOnly = HeatmapFixationsOnly && ShapeType == Heatmap;
+
+		HasPendingSample = false;
+
+		Point gazePoint = {};
+
+		if (isFixationsOnly)
+		{
+			// 注视中每帧在中心加一次热量，热量自然与注视时长成正比
+			FixationEvent fixation = {};
+			isActive  = isActive && Classifier.GetCurrentFixation(fixation);
+			gazePoint = fixation.Centroid;
+		}
+		else if (isActive)
+		{
+			isActive = Predictor.Predict(frameTimestamp + PredictionLatency, gazePoint);
+		}
+
+		PushGazePoint(isActive, gazePoint);
+	}
+
+	bool  HasGaze() const { return GazeStepIndex < GazeStepCount; }
+	Point CurrentGaze() const { return GazeSteps[GazeStepIndex]; }
+	void  ClearGaze() { GazeStepIndex = GazeStepCount; }
+
+	// 每帧渲染前调用，timestamp 单位为微秒
+	void AdvanceFrame(int64_t timestamp)
+	{
+		if (LastFrameTimestamp != 0)
+			FrameDelta = static_cast<float>(std::max<int64_t>(timestamp - LastFrameTimestamp, 0)) * 1e-6f;
+
+		LastFrameTimestamp = timestamp;
+
+		// 每帧的衰减系数随 dt 变化，常量缓冲需要重新填
+		if (TimeBasedDecay)
+			DataIsDirty = true;
+	}
+
+	// 本帧实际使用的衰减系数
+	float FrameDecay() const
+	{
+		auto decay = ShapeType == Heatmap ? Decay : 0.95f;
+
+		if (!TimeBasedDecay)
+			return decay;
+
+		return std::pow(decay, FrameDelta * ReferenceFrameRate);
+	}
+
+	// 本帧 splat 热量相对参考帧率下一帧的倍数，经常量缓冲的 GainScale 传给 SoftKernels；Shader 里的系数是写死的，GPU 路径上固定为 1
+	float FrameGainScale() const
+	{
+		if (!TimeBasedDecay)
+			return 1.0f;
+
+		return std::fmin(FrameDelta, MaxSplatDuration) * ReferenceFrameRate;
+	}
+
+	void TrackFieldPeak(float decay, float gain)
+	{
+		FieldPeak = FieldPeak * decay + gain;
+	}
+
+	bool IsFieldConverged() const { return FieldPeak < VisibleThreshold; }
+
+	// 按当前状态填充一帧的 Pixel Shader 常量，width/height 为主渲染目标尺寸
+	void FillConstantData(PSConstantData& data, float width, float height) const
+	{
+		memset(&data, 0, sizeof(PSConstantData));
+
+		if (HasGaze())
+		{
+			auto gazePoint = CurrentGaze();
+
+			data.GazePoint.X = gazePoint.X / width;
+			data.GazePoint.Y = gazePoint.Y / height;
+		}
+
+		data.AspectRatio     = width / height;
+		data.Decay           = FrameDecay();
+		data.GainScale       = FrameGainScale();
+		data.SizeSquared     = Size * Size;
+		data.Trail           = Trail;
+		data.Color           = ShapeType == Heatmap ? OverlayColor{1.0f, 1.0f, 1.0f, 0.6f} : Color;
+		data.BackgroundColor = ShapeType == Heatmap ? OverlayColor{0.0f, 0.0f, 0.0f, 0.0f} : BackgroundColor;
+	}
+};